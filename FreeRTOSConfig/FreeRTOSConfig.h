@@ -69,7 +69,7 @@
 #define configMESSAGE_BUFFER_LENGTH_TYPE size_t
 
 /* Memory allocation related definitions. */
-#define configSUPPORT_STATIC_ALLOCATION 0
+#define configSUPPORT_STATIC_ALLOCATION 1
 #define configSUPPORT_DYNAMIC_ALLOCATION 1
 #define configTOTAL_HEAP_SIZE (64 * 1024)
 #define configAPPLICATION_ALLOCATED_HEAP 0
@@ -102,8 +102,22 @@
 */
 
 /* SMP port only */
+/* Set VIDEO_FREERTOS_SMP to 1 to run the kernel on both cores, with the USB task
+ * pinned to core 0 (where the USB and capture interrupts are enabled) and the
+ * camera task to core 1. */
+#ifndef VIDEO_FREERTOS_SMP
+#define VIDEO_FREERTOS_SMP 0
+#endif
+#if VIDEO_FREERTOS_SMP
+#define configNUMBER_OF_CORES 2
+#define configNUM_CORES 2
+#define configUSE_CORE_AFFINITY 1
+#define configUSE_PASSIVE_IDLE_HOOK 0
+#define configTICK_CORE 0
+#else
 #define configNUM_CORES 1
 #define configTICK_CORE 1
+#endif
 #define configRUN_MULTIPLE_PRIORITIES 1
 
 /* RP2040 specific */
@@ -0,0 +1,86 @@
+/**
+ * Frame buffer ownership for the capture, see frame_pool.h.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "frame_pool.h"
+
+void frame_pool_init(struct frame_pool *pool, unsigned count) {
+    pool->count = count < FRAME_POOL_MAX_BUFS ? count : FRAME_POOL_MAX_BUFS;
+    for (unsigned i = 0; i < FRAME_POOL_MAX_BUFS; i++) {
+        pool->state[i] = FRAME_FREE;
+        pool->refs[i] = 0;
+    }
+    pool->capturing = -1;
+    pool->dropped = 0;
+}
+
+int frame_pool_capture(struct frame_pool *pool) {
+    if (pool->capturing >= 0)
+        return -1;
+    for (unsigned i = 0; i < pool->count; i++) {
+        if (pool->state[i] == FRAME_FREE) {
+            pool->state[i] = FRAME_CAPTURING;
+            pool->capturing = (int)i;
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+int frame_pool_ready(struct frame_pool *pool) {
+    int idx = pool->capturing;
+    if (idx < 0)
+        return -1;
+    pool->capturing = -1;
+
+    // Only the newest frame is worth sending, recycle one the consumer never took.
+    for (unsigned i = 0; i < pool->count; i++) {
+        if (pool->state[i] == FRAME_READY) {
+            pool->state[i] = FRAME_FREE;
+            pool->dropped++;
+        }
+    }
+    pool->state[idx] = FRAME_READY;
+    return idx;
+}
+
+void frame_pool_abort(struct frame_pool *pool) {
+    if (pool->capturing < 0)
+        return;
+    pool->state[pool->capturing] = FRAME_FREE;
+    pool->capturing = -1;
+}
+
+void frame_pool_flush(struct frame_pool *pool) {
+    for (unsigned i = 0; i < pool->count; i++) {
+        if (pool->state[i] == FRAME_READY)
+            pool->state[i] = FRAME_FREE;
+    }
+}
+
+int frame_pool_get(struct frame_pool *pool) {
+    for (unsigned i = 0; i < pool->count; i++) {
+        if (pool->state[i] == FRAME_READY) {
+            pool->state[i] = FRAME_IN_USE;
+            pool->refs[i] = 1;
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+bool frame_pool_ref(struct frame_pool *pool, unsigned i) {
+    if (i >= pool->count || pool->state[i] != FRAME_IN_USE)
+        return false;
+    pool->refs[i]++;
+    return true;
+}
+
+bool frame_pool_release(struct frame_pool *pool, unsigned i) {
+    if (i >= pool->count || pool->state[i] != FRAME_IN_USE || --pool->refs[i] != 0)
+        return false;
+    pool->state[i] = FRAME_FREE;
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+#include <stdbool.h>
+#include <stdint.h>
+
+#define FRAME_POOL_MAX_BUFS 3
+
+enum {
+    FRAME_FREE,
+    FRAME_CAPTURING,
+    FRAME_READY,
+    FRAME_IN_USE,
+};
+
+// Who owns each frame buffer: the capture DMA writes one, the newest complete one
+// waits for a consumer, and consumers hold theirs by reference count until the
+// last one lets go. Only the bookkeeping lives here, the caller serialises access
+// (ov2640.c takes its spin lock) and drives the DMA.
+struct frame_pool {
+    unsigned count;
+    volatile uint8_t state[FRAME_POOL_MAX_BUFS];
+    volatile uint8_t refs[FRAME_POOL_MAX_BUFS]; // consumers holding a FRAME_IN_USE buffer
+    volatile int capturing;                     // buffer being captured into, -1 when none
+    volatile uint32_t dropped;                  // READY frames recycled before anyone took them
+};
+
+// count buffers, all free.
+void frame_pool_init(struct frame_pool *pool, unsigned count);
+
+// Claim a free buffer to capture into. Returns its index, or -1 if one is already
+// being captured or every buffer is held.
+int frame_pool_capture(struct frame_pool *pool);
+// The buffer being captured into is complete and replaces any READY frame nobody
+// took. Returns its index, -1 if none was being captured.
+int frame_pool_ready(struct frame_pool *pool);
+// The buffer being captured into is given up, free again.
+void frame_pool_abort(struct frame_pool *pool);
+// Free READY frames, e.g. of a mode that is no longer streamed. Held frames stay.
+void frame_pool_flush(struct frame_pool *pool);
+
+// Take the READY frame with one reference. Returns its index, -1 if none is ready.
+int frame_pool_get(struct frame_pool *pool);
+// Another reference to a taken frame. False if buffer i is not in use.
+bool frame_pool_ref(struct frame_pool *pool, unsigned i);
+// Drop a reference. True if it was the last, and buffer i is free again.
+bool frame_pool_release(struct frame_pool *pool, unsigned i);
+
+#endif
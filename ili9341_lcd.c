@@ -21,6 +21,8 @@
 
 #define USE_BIT_BANGING 0
 #if USE_BIT_BANGING == 0
+#include "hardware/dma.h"
+#include "hardware/irq.h"
 #include "hardware/pio.h"
 #include "hardware/pio_instructions.h"
 #include "ili9341_lcd.pio.h"
@@ -98,11 +100,78 @@ void pioinit(uint32_t clock_freq) {
     ili9341_lcd_program_init(tft_pio, pio_sm, program_offset, PIN_DOUT, PIN_CLK, (float)clock_freq);
     printf("initial ili9341 with PIO\n");
 }
+
+// Frame pushes are streamed to the PIO by DMA, 16 bits per pixel. Commands
+// still go byte by byte through shiftout(), which switches the pull threshold
+// back once the DMA has finished. lcd_send_cmd() drains the DMA and the PIO
+// before it drops RS, so a window change (ili9341_show_frame_size()) may be
+// issued while the last push is still in flight.
+static int lcd_dma_chan = -1;
+static bool lcd_pull16;
+static volatile bool lcd_dma_busy;
+static size_t lcd_dma_len;
+static void (*lcd_dma_done_cb)(void);
+
+static void lcd_dma_irq_handler(void) {
+    if (!(dma_hw->ints1 & (1u << lcd_dma_chan)))
+        return;
+    dma_hw->ints1 = 1u << lcd_dma_chan;
+    lcd_dma_busy = false;
+    if (lcd_dma_done_cb)
+        lcd_dma_done_cb();
+}
+
+static void lcd_dma_init(void) {
+    lcd_dma_chan = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(lcd_dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(tft_pio, pio_sm, true));
+    dma_channel_configure(lcd_dma_chan, &c, &tft_pio->txf[pio_sm], NULL, 0, false);
+
+    dma_channel_set_irq1_enabled(lcd_dma_chan, true);
+    irq_set_exclusive_handler(DMA_IRQ_1, lcd_dma_irq_handler);
+    irq_set_enabled(DMA_IRQ_1, true);
+}
+
+void ili9341_show_dma_wait(void) {
+    while (lcd_dma_busy)
+        tight_loop_contents();
+}
+
+bool ili9341_show_dma_busy(void) {
+    return lcd_dma_busy;
+}
+
+// Bytes of the current (or last) DMA push already handed to the PIO.
+size_t ili9341_show_dma_sent(void) {
+    return lcd_dma_len - dma_channel_hw_addr(lcd_dma_chan)->transfer_count * 2;
+}
+
+// Start pushing len pixels in the background. data must stay untouched until
+// done is called from the DMA interrupt, or ili9341_show_dma_sent() has passed it.
+void ili9341_show_rgb565_dma(const uint16_t *data, int len, void (*done)(void)) {
+    ili9341_show_dma_wait();
+    if (!lcd_pull16) {
+        ili9341_lcd_set_pull_bits(tft_pio, pio_sm, 16);
+        lcd_pull16 = true;
+    }
+    lcd_dma_len = (size_t)len * 2;
+    lcd_dma_done_cb = done;
+    lcd_dma_busy = true;
+    dma_channel_transfer_from_buffer_now(lcd_dma_chan, data, (uint)len);
+}
 #endif
 
 static inline void shiftout( uint16_t val,uint8_t bits) {
 
 #if USE_BIT_BANGING == 0
+    if (lcd_pull16) {
+        ili9341_show_dma_wait();
+        ili9341_lcd_set_pull_bits(tft_pio, pio_sm, 8);
+        lcd_pull16 = false;
+    }
     if(bits == 8)
     {
         ili9341_lcd_wait_idle(tft_pio,pio_sm);
@@ -132,6 +201,11 @@ static inline void shiftout( uint16_t val,uint8_t bits) {
 }
 
 static inline void lcd_send_cmd(const uint8_t cmd) {
+#if USE_BIT_BANGING == 0
+    // RS must not drop under pixels still queued in the DMA or the PIO FIFO.
+    ili9341_show_dma_wait();
+    ili9341_lcd_wait_idle(tft_pio, pio_sm);
+#endif
     gpio_put(PIN_RS, 0);
     shiftout(cmd, 8);
     gpio_put(PIN_RS, 1);
@@ -246,74 +320,63 @@ static void ili9341_openwindow(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y
     lcd_send_cmd(RAMWR);
 }
 
-void ili9341_show_rgb565_data(uint16_t *data, int len) {
+// Restart RAM writes at the top left corner, so the following pixels start a new frame.
+void ili9341_show_frame_begin(void) {
+    ili9341_openwindow(0, 0, SCREEN_HEIGHT, SCREEN_WIDTH);
+}
+
+// Frames smaller than the screen are drawn in a window of their own size at the top left.
+void ili9341_show_frame_size(uint16_t width, uint16_t height) {
+    ili9341_openwindow(0, 0, width, height);
+}
+
+void ili9341_show_rgb565_data(const uint16_t *data, int len) {
+#if USE_BIT_BANGING == 0
+    ili9341_show_rgb565_dma(data, len, NULL);
+    ili9341_show_dma_wait();
+#else
     for (int i = 0; i < len; i++) {
         shiftout(*data++, 16);
     }
+#endif
 }
 
-uint16_t yuv422_to_rgb565(int y, int u, int v) {
-    uint16_t rgb = 0;
-    VP8YuvToRgb565(y,u,v,(uint8_t *)&rgb);
-    *(volatile uint8_t *)&tft_pio->txf[pio_sm] = (rgb >> 8);
-    *(volatile uint8_t *)&tft_pio->txf[pio_sm] = rgb & 0xff;
-    return rgb;
+#if USE_BIT_BANGING == 1
+// No DMA when bit banging, the push is done before this returns.
+void ili9341_show_rgb565_dma(const uint16_t *data, int len, void (*done)(void)) {
+    ili9341_show_rgb565_data(data, len);
+    if (done)
+        done();
 }
 
-void rgb565_to_yuv422(uint32_t *data, int len) {
-    //  FIXME: This conversion will lose a lot of color, approaching a grayscale display.
+bool ili9341_show_dma_busy(void) {
+    return false;
+}
 
-    for (int i = 0; i < len; i++, data++) {
-        uint16_t first = *data & 0xffff;
-        uint16_t second = (*data >> 16) & 0xffff;
-        uint8_t *dst = (uint8_t *)data;
+void ili9341_show_dma_wait(void) {
+}
 
-#if 0
-        uint8_t r1,r2,g1,g2,b1,b2;
-        r1 = ((first & (0x1f << 11)) >> 8);
-        g1 = ((first & (0x3f << 5)) >> 3);
-        b1 = ((first & (0x1f << 0)) << 3);
-        dst[0] = VP8RGBToY(r1, g1, b1, YUV_HALF);
+size_t ili9341_show_dma_sent(void) {
+    return 0;
+}
+#endif
 
-        r2 = ((second & (0x1f << 11)) >> 8);
-        g2 = ((second & (0x3f << 5)) >> 3);
-        b2 = ((second & (0x1f << 0)) << 3);
-        dst[2] = VP8RGBToY(r2, g2, b2, YUV_HALF);
+// YUYV frames are converted a line at a time into one of two RGB565 buffers,
+// each pushed by DMA while the next one is converted.
+#define LCD_YUV_LINE_WORDS 160
 
-        dst[1] = VP8RGBToU(r1 + r2, g1 + g2, b1 + b2, YUV_HALF << 2);
-        dst[3] = VP8RGBToV(r1 + r2, g1 + g2, b1 + b2, YUV_HALF << 2);
-#else
-        uint8_t rgb1[3], rgb2[3];
-        color16to24(first, rgb1);
-        color16to24(second, rgb2);
-        dst[0] = VP8RGBToY(rgb1[0], rgb1[1], rgb1[2], YUV_HALF);
-        dst[2] = VP8RGBToY(rgb2[0], rgb2[1], rgb2[2], YUV_HALF);
-
-        dst[1] = VP8RGBToU(rgb1[0] + rgb2[0], rgb1[1] + rgb2[1], rgb1[2] + rgb2[2], YUV_HALF << 2);
-        dst[3] = VP8RGBToV(rgb1[0] + rgb2[0], rgb1[1] + rgb2[1], rgb1[2] + rgb2[2], YUV_HALF << 2);
-#endif
-    }
-}
+void ili9341_show_yuv422_data(const uint32_t *data, int len) {
+    static uint32_t rgb[2][LCD_YUV_LINE_WORDS];
+    static int cur;
 
-void ili9341_show_yuv422_data(uint32_t *data, int len) {
-    int y1, y2, u, v;
-    uint16_t pixels = 0;
+    while (len > 0) {
+        int n = len < LCD_YUV_LINE_WORDS ? len : LCD_YUV_LINE_WORDS;
 
-    // Extract yuv components
-    for (int i = 0; i < len; i++) {
-#if 1
-        y1 = *data & 0xff;
-        u = (*data >> 8) & 0xff;
-        y2 = (*data >> 16) & 0xff;
-        v = (*data++ >> 24) & 0xff;
-#else
-        u = raw & 0xff;
-        y1 = (raw >> 8) & 0xff;
-        v = (raw >> 16) & 0xff;
-        y2 = (raw >> 24) & 0xff;
-#endif
-        yuv422_to_rgb565(y1, u, v);
-        yuv422_to_rgb565(y2, u, v);
+        yuv422_to_rgb565_words(data, rgb[cur], n);
+        ili9341_show_rgb565_dma((const uint16_t *)rgb[cur], n * 2, NULL);
+        cur ^= 1;
+        data += n;
+        len -= n;
     }
 }
 
@@ -321,6 +384,7 @@ int main_lcd_init() {
 
 #if USE_BIT_BANGING == 0
     pioinit(128000000);
+    lcd_dma_init();
 #else
     gpio_init(PIN_DOUT);
     gpio_init(PIN_CLK);
@@ -0,0 +1,90 @@
+/**
+ * JPEG marker search in capture buffers.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "jpeg.h"
+
+// Non-zero if any byte of w is 0xff: finds a zero byte in ~w.
+static inline uint32_t has_ff(uint32_t w) {
+    w = ~w;
+    return (w - 0x01010101u) & ~w & 0x80808080u;
+}
+
+static inline bool is_soi(const uint8_t *buf, size_t len, size_t i) {
+    return i + 3 <= len && buf[i] == 0xff && buf[i + 1] == 0xd8 && buf[i + 2] == 0xff;
+}
+
+static inline bool is_eoi(const uint8_t *buf, size_t len, size_t i) {
+    return i + 2 <= len && buf[i] == 0xff && buf[i + 1] == 0xd9;
+}
+
+// Forwards, a word at a time once buf + i is aligned; only words holding an 0xff
+// are looked at byte by byte.
+static bool find_soi(const uint8_t *buf, size_t len, size_t *at) {
+    size_t i = 0;
+
+    for (; i < len && ((uintptr_t)(buf + i) & 3); i++) {
+        if (is_soi(buf, len, i))
+            goto found;
+    }
+    for (; i + 4 <= len; i += 4) {
+        if (!has_ff(*(const uint32_t *)(buf + i)))
+            continue;
+        for (size_t j = i; j < i + 4; j++) {
+            if (is_soi(buf, len, j)) {
+                i = j;
+                goto found;
+            }
+        }
+    }
+    for (; i < len; i++) {
+        if (is_soi(buf, len, i))
+            goto found;
+    }
+    return false;
+found:
+    *at = i;
+    return true;
+}
+
+// Backwards from the end of buf, so the data after the image (the rest of the
+// last DMA word, or whatever the sensor sent until VSYNC) is skipped first.
+static bool find_eoi(const uint8_t *buf, size_t start, size_t len, size_t *at) {
+    size_t i = len;
+
+    for (; i > start && ((uintptr_t)(buf + i) & 3); i--) {
+        if (is_eoi(buf, len, i - 1))
+            goto found;
+    }
+    for (; i >= start + 4; i -= 4) {
+        if (!has_ff(*(const uint32_t *)(buf + i - 4)))
+            continue;
+        for (size_t j = i; j > i - 4; j--) {
+            if (is_eoi(buf, len, j - 1)) {
+                i = j;
+                goto found;
+            }
+        }
+    }
+    for (; i > start; i--) {
+        if (is_eoi(buf, len, i - 1))
+            goto found;
+    }
+    return false;
+found:
+    *at = i - 1;
+    return true;
+}
+
+bool jpeg_find_span(const uint8_t *buf, size_t len, struct jpeg_span *span) {
+    size_t soi, eoi;
+
+    if (!find_soi(buf, len, &soi) || !find_eoi(buf, soi + 2, len, &eoi))
+        return false;
+    span->soi = soi;
+    span->eoi = eoi;
+    span->len = eoi + 2 - soi;
+    return true;
+}
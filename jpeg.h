@@ -0,0 +1,18 @@
+#ifndef JPEG_H
+#define JPEG_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Where a JPEG image sits in a capture buffer.
+struct jpeg_span {
+    size_t soi; // offset of the FF D8 FF start marker
+    size_t eoi; // offset of the last FF D9 end marker
+    size_t len; // eoi + 2 - soi, the bytes to send
+};
+
+// Look for the first SOI and the last EOI after it in the first len bytes of buf.
+// Returns false, and leaves span alone, if either marker is missing.
+bool jpeg_find_span(const uint8_t *buf, size_t len, struct jpeg_span *span);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef LCD_JOB_H
+#define LCD_JOB_H
+#include <stddef.h>
+
+#include "hardware/sync.h"
+
+// Single producer / single consumer handoff of one frame at a time, for the LCD
+// push on core1 in main.c. The producer only posts when frame is NULL; the
+// consumer publishes how far it got and clears frame when it is done with it.
+struct lcd_job {
+    void *volatile frame;
+    volatile size_t pushed;
+};
+
+// Producer: hand over frame, once the consumer is done with the last one.
+static inline void lcd_job_post(struct lcd_job *job, void *frame) {
+    while (job->frame != NULL)
+        __wfe();
+    __dmb();
+    job->pushed = 0;
+    __dmb();
+    job->frame = frame;
+    __sev();
+}
+
+// Producer: wait until the first len bytes are pushed, or the whole frame is.
+static inline void lcd_job_wait(struct lcd_job *job, size_t len) {
+    while (job->frame != NULL && job->pushed < len)
+        __wfe();
+    __dmb();
+}
+
+// Consumer: wait for the next frame.
+static inline void *lcd_job_take(struct lcd_job *job) {
+    void *frame;
+    while ((frame = job->frame) == NULL)
+        __wfe();
+    __dmb();
+    return frame;
+}
+
+// Consumer: the first pushed bytes are out, the producer may overwrite them.
+static inline void lcd_job_progress(struct lcd_job *job, size_t pushed) {
+    __dmb();
+    job->pushed = pushed;
+    __sev();
+}
+
+// Consumer: done with the frame, after dropping its reference to it.
+static inline void lcd_job_done(struct lcd_job *job) {
+    __dmb();
+    job->frame = NULL;
+    __sev();
+}
+
+#endif
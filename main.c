@@ -31,6 +31,8 @@
 #endif
 
 #include "hardware/dma.h"
+#include "hardware/sync.h"
+#include "pico/multicore.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -39,8 +41,17 @@
 #include "hardware/clocks.h"
 #include "tusb.h"
 #include "usb_descriptors.h"
+#ifdef USE_FREERTOS
+#include "device/usbd_pvt.h"
+#endif
 
+#include "jpeg.h"
+#include "lcd_job.h"
 #include "ov2640.h"
+#ifdef USE_FREERTOS
+#include "video_pacing.h"
+#endif
+#include "yuv.h"
 
 // refs https://blog.usedbytes.com/2022/02/pico-pio-camera/
 //--------------------------------------------------------------------+
@@ -59,6 +70,38 @@ enum {
 };
 
 static uint32_t blink_interval_ms = BLINK_NOT_MOUNTED;
+
+/* Set to 1 to print per-stage timing of video_task() every VIDEO_STATS_FRAMES frames,
+ * so pipeline changes can be compared on the board without an external profiler.
+ * The report counts UVC frames, so there is none in CAPTURE_STRIPS mode. */
+#define VIDEO_STATS 0
+#define VIDEO_STATS_FRAMES 100
+/* The report also covers capture-to-host latency and VSYNC jitter over the last
+ * VIDEO_TIMING_RING frames (a power of 2), in VIDEO_TIMING_BUCKET_MS wide histogram buckets.
+ * Both are taken from time_us_32() on the device; no PTS or SCR is sent to the host. */
+#define VIDEO_TIMING_RING 32
+#define VIDEO_TIMING_BUCKETS 8
+#define VIDEO_TIMING_BUCKET_MS 10
+
+/* Set to 1 to feed the LCD preview from a ring of 1 << STRIP_RING_BITS bytes instead
+ * of a full frame buffer, which leaves room for larger frames. tud_video_n_frame_xfer()
+ * needs the whole frame in memory, so UVC streaming is not available in this mode. */
+#define CAPTURE_STRIPS 0
+#define STRIP_RING_BITS 12
+
+/* Set to 1 to push frames to the LCD from core1. Either way the LCD push runs in
+ * the background and the frame is converted for UVC one chunk behind it. */
+#define VIDEO_MULTICORE 0
+#define VIDEO_LCD_CHUNK (FRAME_WIDTH * 2 * 8)
+
+/* Sensor output behind the UVC YUY2 format. PIXFORMAT_RGB565 goes to the LCD as is
+ * and is converted for UVC; PIXFORMAT_YUV422 goes to UVC as is, without the
+ * conversion pass, and is converted for the LCD instead. The MJPEG format switches
+ * the sensor to PIXFORMAT_JPEG and sends its frames as they are. The GREY format
+ * captures YUV422 (PIXFORMAT_GRAYSCALE) and sends only its Y bytes. NV12 and I420
+ * are built from the raw frame, in place. RGBP switches the sensor to RGB565 and
+ * sends the frame the LCD shows, without any conversion. */
+#define VIDEO_RAW_PIXFORMAT PIXFORMAT_RGB565
 const int PIN_LED = 25;
 
 const int PIN_CAM_RESETB = 2;
@@ -69,14 +112,28 @@ const uint8_t CMD_REG_WRITE = 0xAA;
 const uint8_t CMD_REG_READ = 0xBB;
 const uint8_t CMD_CAPTURE = 0xCC;
 
-static uint8_t image_buf[FRAME_WIDTH * FRAME_HEIGHT * 2];
-extern void ili9341_show_rgb565_data(uint16_t *data, int len);
-extern void ili9341_show_yuv422_data(uint32_t *data, int len);
-extern void rgb565_to_yuv422(uint32_t *data, int len);
+#if CAPTURE_STRIPS
+static uint8_t strip_ring[1 << STRIP_RING_BITS] __attribute__((aligned(1 << STRIP_RING_BITS)));
+#else
+static uint8_t image_buf[FRAME_WIDTH * FRAME_HEIGHT * 2] __attribute__((aligned(4)));
+#endif
+extern void ili9341_show_frame_begin(void);
+extern void ili9341_show_frame_size(uint16_t width, uint16_t height);
+extern void ili9341_show_rgb565_data(const uint16_t *data, int len);
+extern void ili9341_show_rgb565_dma(const uint16_t *data, int len, void (*done)(void));
+extern bool ili9341_show_dma_busy(void);
+extern size_t ili9341_show_dma_sent(void);
+extern void ili9341_show_yuv422_data(const uint32_t *data, int len);
 extern int main_lcd_init();
 
 void led_blinking_task(void);
 void video_task(void);
+#ifdef USE_FREERTOS
+static void video_frame_ready(struct ov2640_config *cfg);
+#endif
+#if VIDEO_MULTICORE && !CAPTURE_STRIPS
+static void video_lcd_core1(void);
+#endif
 
 static struct ov2640_config config = {
     .sccb = i2c_default,
@@ -90,10 +147,22 @@ static struct ov2640_config config = {
     .pio = pio0,
     .pio_sm = 0,
     .dma_channel = 0,
-    .image_buf = image_buf,
+    .frame_width = FRAME_WIDTH,
+    .frame_height = FRAME_HEIGHT,
+    // A second QVGA RGB565 frame does not fit next to this one in SRAM, smaller
+    // frame sizes can list more buffers to capture ahead of the consumer.
+#if CAPTURE_STRIPS
+    .image_buf_count = 0,
+    .image_buf_size = FRAME_WIDTH * FRAME_HEIGHT * 2,
+#else
+    .image_bufs = {image_buf},
+    .image_buf_count = 1,
     .image_buf_size = sizeof(image_buf),
-    .pixformat = PIXFORMAT_RGB565,
-    // .pixformat = PIXFORMAT_YUV422,  // FIXME: have to green/inverted block.
+#endif
+    .pixformat = VIDEO_RAW_PIXFORMAT,
+#ifdef USE_FREERTOS
+    .frame_ready_cb = video_frame_ready,
+#endif
 };
 
 #define PLL_SYS_KHZ (133 * 1000)
@@ -105,16 +174,42 @@ TimerHandle_t blinky_tm;
 
 #define TUD_TASK_PRIO (tskIDLE_PRIORITY + 2)
 #define CAM_TASK_PRIO (tskIDLE_PRIORITY + 1)
-TaskHandle_t cam_taskhandle, tud_taskhandle, video_taskhandle;
+// Stack depths in words, budgeted in bytes. printf() and the stdio drivers under
+// it take up to about 1 KB. The USB task runs tud_task() and the tinyusb
+// callbacks, the deepest being the printf() in tud_video_commit_cb(): 2 KB. The
+// camera task runs the conversion and, from video_xfer_done(), the VIDEO_STATS
+// report, which holds 288 bytes of histogram input while it calls printf(): 4 KB.
+#define TUD_TASK_STACK (2048 / sizeof(StackType_t))
+#define CAM_TASK_STACK (4096 / sizeof(StackType_t))
+TaskHandle_t cam_taskhandle, tud_taskhandle;
+
+static StackType_t tud_task_stack[TUD_TASK_STACK], cam_task_stack[CAM_TASK_STACK];
+static StaticTask_t tud_task_tcb, cam_task_tcb;
+
+#if VIDEO_MULTICORE && configNUMBER_OF_CORES > 1
+#error "VIDEO_MULTICORE needs core1 for itself, it cannot be combined with VIDEO_FREERTOS_SMP"
+#endif
 
 
+// Task notification bits of the camera task.
+enum {
+    VIDEO_NOTIFY_FRAME = 1u << 0, // capture DMA finished a frame
+    VIDEO_NOTIFY_XFER = 1u << 1,  // UVC transfer of tx_frame complete
+};
+
+// Wake the camera task as soon as the capture DMA has finished a frame.
+static void video_frame_ready(struct ov2640_config *cfg) {
+    (void)cfg;
+    BaseType_t woken = pdFALSE;
+    xTaskNotifyFromISR(cam_taskhandle, VIDEO_NOTIFY_FRAME, eSetBits, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+// tinyusb is built with CFG_TUSB_OS=OPT_OS_FREERTOS: tud_task() blocks on the
+// event queue and the USB interrupt wakes it.
 void usb_thread(void *ptr) {
-    TickType_t wake;
-    wake = xTaskGetTickCount();
     do {
         tud_task();
-        if (!tud_task_event_ready())
-            xTaskDelayUntil(&wake, 1);
     } while (1);
 }
 #endif
@@ -131,19 +226,30 @@ int main(void) {
     }
     ov2640_init(&config);
     main_lcd_init();
+#if VIDEO_MULTICORE && !CAPTURE_STRIPS
+    multicore_launch_core1(video_lcd_core1);
+#endif
 
 #ifdef USE_FREERTOS
     printf("Running on FreeRTOS\n");
     if (THREADED) {
         blinky_tm = xTimerCreate(NULL, pdMS_TO_TICKS(BLINK_MOUNTED), true, NULL, led_blinking_task);
-        xTaskCreate(usb_thread, "USB", configMINIMAL_STACK_SIZE, NULL, TUD_TASK_PRIO, &tud_taskhandle);
-        xTaskCreate(video_task, "CAMERA", configMINIMAL_STACK_SIZE, NULL, CAM_TASK_PRIO, &cam_taskhandle);
-        // xTaskCreate(video_task, "CAMERA", configMINIMAL_STACK_SIZE, NULL, CAM_TASK_PRIO, &cam_taskhandle);
+        tud_taskhandle = xTaskCreateStatic(usb_thread, "USB", TUD_TASK_STACK, NULL, TUD_TASK_PRIO,
+                                           tud_task_stack, &tud_task_tcb);
+        cam_taskhandle = xTaskCreateStatic((TaskFunction_t)video_task, "CAMERA", CAM_TASK_STACK, NULL,
+                                           CAM_TASK_PRIO, cam_task_stack, &cam_task_tcb);
+#if configNUMBER_OF_CORES > 1
+        vTaskCoreAffinitySet(tud_taskhandle, 1u << 0);
+        vTaskCoreAffinitySet(cam_taskhandle, 1u << 1);
+#endif
         xTimerStart(blinky_tm, 0);
         vTaskStartScheduler();
     }
 #else
     printf("Start main loop\n");
+#if !CAPTURE_STRIPS
+    ov2640_capture_start(&config);
+#endif
     while (1) {
         tud_task(); // tinyusb device task
         led_blinking_task();
@@ -184,118 +290,562 @@ void tud_resume_cb(void) {
 //--------------------------------------------------------------------+
 // USB Video
 //--------------------------------------------------------------------+
+#if !CAPTURE_STRIPS
 static unsigned frame_num = 0;
 static unsigned tx_busy = 0;
+static struct ov2640_frame *tx_frame = NULL;
+#endif
 static unsigned interval_ms = 1000 / FRAME_RATE;
+static volatile uint32_t interval_us = 1000000 / FRAME_RATE; // dwFrameInterval committed by the host
 
-static const uint32_t JPEG_SOI_MARKER = 0xFFD8FF; // written in little-endian for esp32
-static const uint16_t JPEG_EOI_MARKER = 0xD9FF;   // written in little-endian for esp32
+#if defined(USE_FREERTOS) && !CAPTURE_STRIPS
+// Frame pacing of the FreeRTOS video task, see video_pacing.h.
+static struct video_pacing video_pacing;
+#endif
+// bFormatIndex << 8 | bFrameIndex committed by the host, 0 when applied
+static volatile unsigned video_mode_pending;
+#if !CAPTURE_STRIPS
+static unsigned video_format = UVC_FORMAT_YUY2; // bFormatIndex being streamed
+static const char *const video_format_names[UVC_FORMAT_COUNT + 1] = {
+    [UVC_FORMAT_YUY2] = "yuy2", [UVC_FORMAT_MJPEG] = "mjpeg", [UVC_FORMAT_GREY] = "grey",
+    [UVC_FORMAT_NV12] = "nv12", [UVC_FORMAT_I420] = "i420", [UVC_FORMAT_RGBP] = "rgbp",
+};
+static uint8_t yuv420_scratch[YUV420_SCRATCH_SIZE(FRAME_WIDTH, FRAME_HEIGHT)] __attribute__((aligned(4)));
 
-static int cam_verify_jpeg_soi(const uint8_t *inbuf, int length) {
-    for (int i = 0; i < (int )length; i++) {
-        if (memcmp(&inbuf[i], &JPEG_SOI_MARKER, 3) == 0) {
-            return i;
-        }
+struct video_frame_size {
+    uint16_t width, height;
+};
+
+#define VIDEO_FRAME_SIZE(_frmidx, _width, _height, _fps) [_frmidx - 1] = {_width, _height},
+static const struct video_frame_size video_frame_sizes[UVC_FRAME_COUNT] = {
+    UVC_FRAME_SIZES(VIDEO_FRAME_SIZE)
+};
+static const struct video_frame_size video_mjpeg_frame_sizes[UVC_MJPEG_FRAME_COUNT] = {
+    UVC_MJPEG_FRAME_SIZES(VIDEO_FRAME_SIZE)
+};
+#undef VIDEO_FRAME_SIZE
+#endif
+
+#if VIDEO_STATS && !CAPTURE_STRIPS
+enum {
+    STAGE_CAPTURE,
+    STAGE_LCD,
+    STAGE_CONVERT,
+    STAGE_XFER,
+    STAGE_COUNT,
+};
+
+static const char *const stage_names[STAGE_COUNT] = {"capture", "lcd", "convert", "xfer"};
+
+static struct {
+    uint64_t stage_us[STAGE_COUNT];
+    uint32_t stage_start_us;
+    uint32_t xfer_start_us;
+    uint32_t period_start_us;
+    uint32_t frames;
+    uint32_t jpeg_bad;
+} video_stats;
+
+static inline void video_stats_begin(void) {
+    video_stats.stage_start_us = time_us_32();
+}
+
+static inline void video_stats_end(int stage) {
+    uint32_t now = time_us_32();
+    video_stats.stage_us[stage] += now - video_stats.stage_start_us;
+    video_stats.stage_start_us = now;
+}
+
+static inline void video_stats_jpeg_bad(void) {
+    video_stats.jpeg_bad++;
+}
+
+// Per-frame time stamps, all from time_us_32(). Only one frame is in flight on
+// the UVC stream, it is filled in at video_timing[video_timing_head]. video_stats
+// and video_timing belong to whoever runs video_task(), the transfer complete
+// callback only leaves its time stamp in video_xfer_done_us.
+struct video_timing {
+    uint32_t vsync_us;   // capture started on the VSYNC rising edge
+    uint32_t dma_us;     // capture DMA done
+    uint32_t convert_us; // converted and queued for UVC
+    uint32_t xfer_us;    // UVC transfer complete
+};
+
+static struct video_timing video_timing[VIDEO_TIMING_RING];
+static uint32_t video_timing_head, video_timing_count;
+static volatile uint32_t video_xfer_done_us;
+
+static inline void video_stats_xfer_complete(void) {
+    video_xfer_done_us = time_us_32();
+}
+
+static inline void video_stats_xfer_begin(struct ov2640_frame *frame) {
+    struct video_timing *t = &video_timing[video_timing_head];
+    video_stats.xfer_start_us = time_us_32();
+    t->vsync_us = frame->vsync_us;
+    t->dma_us = frame->done_us;
+    t->convert_us = video_stats.xfer_start_us;
+}
+
+static void video_timing_hist_print(const char *name, const uint32_t *us, uint32_t n) {
+    uint32_t hist[VIDEO_TIMING_BUCKETS] = {0};
+    uint32_t min = UINT32_MAX, max = 0;
+    uint64_t sum = 0;
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t bucket = us[i] / (VIDEO_TIMING_BUCKET_MS * 1000);
+        hist[MIN(bucket, VIDEO_TIMING_BUCKETS - 1)]++;
+        min = MIN(min, us[i]);
+        max = MAX(max, us[i]);
+        sum += us[i];
+    }
+    printf("  %-8s min %u avg %u max %u us |", name, (unsigned)min, (unsigned)(sum / n), (unsigned)max);
+    for (int i = 0; i < VIDEO_TIMING_BUCKETS; i++)
+        printf(" %u", (unsigned)hist[i]);
+    printf(" | per %u ms\n", VIDEO_TIMING_BUCKET_MS);
+}
+
+// Latency from VSYNC to the end of the UVC transfer of the frames sent, and the
+// sensor's VSYNC to VSYNC period as sampled by the VSYNC interrupt.
+static void video_timing_report(void) {
+    uint32_t n = MIN(video_timing_count, VIDEO_TIMING_RING);
+    uint32_t latency[VIDEO_TIMING_RING], period[OV2640_VSYNC_RING];
+    uint periods = ov2640_vsync_periods(&config, period, OV2640_VSYNC_RING);
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t idx = (video_timing_head - n + i) % VIDEO_TIMING_RING;
+        latency[i] = video_timing[idx].xfer_us - video_timing[idx].vsync_us;
     }
-    printf("NO-SOI,%d %d %d %d\n", inbuf[0], inbuf[1], inbuf[2], inbuf[3]);
-    return -1;
+    if (n) {
+        printf("  latency is VSYNC to transfer done on the device clock, not UVC PTS\n");
+        video_timing_hist_print("latency", latency, n);
+    }
+    if (periods)
+        video_timing_hist_print("period", period, periods);
 }
 
-static int cam_verify_jpeg_eoi(const uint8_t *inbuf, int length) {
-    int offset = -1;
-    const uint8_t *dptr = inbuf + length - 2;
-    while (dptr > inbuf) {
-        if (memcmp(dptr, &JPEG_EOI_MARKER, 2) == 0) {
-            offset = dptr - inbuf;
-            return offset;
+static void video_stats_xfer_end(void) {
+    uint32_t now = time_us_32();
+    video_stats.stage_us[STAGE_XFER] += video_xfer_done_us - video_stats.xfer_start_us;
+    video_timing[video_timing_head].xfer_us = video_xfer_done_us;
+    video_timing_head = (video_timing_head + 1) % VIDEO_TIMING_RING;
+    video_timing_count++;
+
+    if (++video_stats.frames < VIDEO_STATS_FRAMES)
+        return;
+
+    uint32_t elapsed_us = now - video_stats.period_start_us;
+    uint32_t cycles_per_us = clock_get_hz(clk_sys) / 1000000;
+    printf("video: %u frames in %u ms, %u.%02u fps\n", (unsigned)video_stats.frames, (unsigned)(elapsed_us / 1000),
+           (unsigned)(video_stats.frames * 1000000ull / elapsed_us),
+           (unsigned)(video_stats.frames * 100000000ull / elapsed_us % 100));
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        uint32_t avg_us = (uint32_t)(video_stats.stage_us[i] / video_stats.frames);
+        printf("  %-8s %7u us/frame %10u cycles/frame\n", stage_names[i], (unsigned)avg_us,
+               (unsigned)(avg_us * cycles_per_us));
+        video_stats.stage_us[i] = 0;
+    }
+    if (video_stats.jpeg_bad)
+        printf("  %u JPEG frames without SOI/EOI dropped\n", (unsigned)video_stats.jpeg_bad);
+    video_timing_report();
+#if defined(USE_FREERTOS) && !CAPTURE_STRIPS
+    printf("  pacing: %u overruns, %u slots skipped, %u frames dropped\n", (unsigned)video_pacing.overruns,
+           (unsigned)video_pacing.skipped, (unsigned)video_pacing.dropped);
+    video_pacing.overruns = video_pacing.skipped = video_pacing.dropped = 0;
+#endif
+    video_stats.jpeg_bad = 0;
+    video_stats.frames = 0;
+    video_stats.period_start_us = now;
+}
+#else
+#define video_stats_begin()
+#define video_stats_end(stage)
+#define video_stats_jpeg_bad()
+#define video_stats_xfer_begin(frame)
+#define video_stats_xfer_complete()
+#define video_stats_xfer_end()
+#endif
+
+#if !CAPTURE_STRIPS
+static void video_lcd_show(uint8_t *buf, size_t len) {
+    if (config.pixformat == PIXFORMAT_RGB565) {
+        ili9341_show_rgb565_data((void *)buf, (int)(len / 2));
+    } else if (config.pixformat == PIXFORMAT_YUV422 || config.pixformat == PIXFORMAT_GRAYSCALE) {
+        ili9341_show_yuv422_data((void *)buf, (int)(len / 4));
+    }
+}
+
+#if VIDEO_MULTICORE
+// The frame being shown, posted by core0 and pushed by core1, see lcd_job.h.
+static struct lcd_job lcd_job;
+
+static void video_lcd_core1(void) {
+    while (1) {
+        struct ov2640_frame *frame = lcd_job_take(&lcd_job);
+
+        for (size_t off = 0; off < config.image_buf_size; off += VIDEO_LCD_CHUNK) {
+            size_t len = MIN(VIDEO_LCD_CHUNK, config.image_buf_size - off);
+            video_lcd_show(frame->buf + off, len);
+            lcd_job_progress(&lcd_job, off + len);
         }
-        dptr--;
+        ov2640_capture_release_frame(&config, frame);
+        lcd_job_done(&lcd_job);
     }
-    printf("NO-EOI, %d %d %d %d\n", inbuf[length - 4], inbuf[length - 3], inbuf[length - 2], inbuf[length - 1]);
-    return -1;
 }
 
-void video_task(void) {
+// Wait until core1 has pushed the first len bytes of the frame.
+static void video_lcd_wait(size_t len) {
+    lcd_job_wait(&lcd_job, len);
+}
+#else
+static struct ov2640_frame *volatile lcd_frame; // read by the LCD DMA
+
+// LCD DMA done: drop the LCD's reference to the frame.
+static void video_lcd_done(void) {
+    struct ov2640_frame *frame = lcd_frame;
+    lcd_frame = NULL;
+    ov2640_capture_release_frame(&config, frame);
+}
+
+// Wait until the LCD DMA has read the first len bytes of the frame.
+static void video_lcd_wait(size_t len) {
+    while (ili9341_show_dma_busy() && ili9341_show_dma_sent() < len)
+        tight_loop_contents();
+}
+#endif
+
+// Push a captured frame to the LCD, in whatever format the sensor produced it.
+// The LCD takes its own reference to the frame and drops it once the frame is
+// on the screen, the caller keeps (and releases) its own. RGB565 frames go out
+// in the background (by DMA, or from core1 in multicore mode), video_lcd_wait()
+// must be called before the buffer is modified.
+// JPEG frames are not shown, the LCD keeps the last raw frame.
+static void video_frame_show(struct ov2640_frame *frame) {
+    if (config.pixformat == PIXFORMAT_JPEG)
+        return;
+    ov2640_capture_ref_frame(&config, frame);
+#if VIDEO_MULTICORE
+    // core1 may still be pushing the last frame.
+    lcd_job_post(&lcd_job, frame);
+#else
+    if (config.pixformat == PIXFORMAT_RGB565) {
+        lcd_frame = frame;
+        ili9341_show_rgb565_dma((void *)frame->buf, (int)(config.image_buf_size / 2), video_lcd_done);
+    } else {
+        video_lcd_show(frame->buf, config.image_buf_size);
+        ov2640_capture_release_frame(&config, frame);
+    }
+#endif
+}
 
 #ifdef USE_FREERTOS
-    do {
-        vTaskDelay(pdMS_TO_TICKS(200));
-        ov2640_capture_frame(&config);
+// The transfer video_frame_send() handed to the USB task, queued until it has run.
+static void *video_xfer_buf;
+static size_t video_xfer_size;
+static volatile bool video_xfer_queued;
+
+// Runs in tud_task(): tinyusb's device calls are not thread safe, and with SMP the
+// USB task runs on the other core while the camera task converts. A frame the
+// stack refuses, the host having stopped streaming, comes back as if sent.
+static void video_xfer_start(void *param) {
+    (void)param;
+    if (!tud_video_n_frame_xfer(0, 0, video_xfer_buf, video_xfer_size)) {
+        video_stats_xfer_complete();
+        xTaskNotify(cam_taskhandle, VIDEO_NOTIFY_XFER, eSetBits);
+    }
+    video_xfer_queued = false;
+}
+#endif
 
-        if (config.pixformat == PIXFORMAT_JPEG) {
-            cam_verify_jpeg_eoi(config.image_buf, (int)config.image_buf_size);
-            cam_verify_jpeg_soi(config.image_buf, (int)config.image_buf_size);
+// Convert a frame to the committed UVC format and queue it on the stream. The
+// buffer stays owned by the transfer until tud_video_frame_xfer_complete_cb()
+// hands it back.
+static void video_frame_send(struct ov2640_frame *frame) {
+    uint8_t *buf = frame->buf;
+    size_t size = config.image_buf_size;
+    if (config.pixformat == PIXFORMAT_JPEG) {
+        // Send SOI..EOI only, the DMA stops at the next VSYNC with padding behind.
+        struct jpeg_span span;
+        if (!jpeg_find_span(buf, frame->len, &span)) {
+            video_stats_jpeg_bad();
+            tx_busy = 0;
+            ov2640_capture_release_frame(&config, frame);
+            return;
+        }
+        buf += span.soi;
+        size = span.len;
+    } else if (video_format == UVC_FORMAT_NV12 || video_format == UVC_FORMAT_I420) {
+        // Convert and subsample a row pair at a time behind the LCD push, then sort
+        // the rows into planes.
+        enum yuv420_layout layout = video_format == UVC_FORMAT_NV12 ? YUV420_NV12 : YUV420_I420;
+        for (uint pair = 0; pair < config.frame_height / 2; pair++) {
+            video_lcd_wait((pair + 1) * config.frame_width * 4);
+            yuv420_pack_rows(buf, (int)config.frame_width, (int)pair, layout,
+                             config.pixformat == PIXFORMAT_RGB565, yuv420_scratch);
+        }
+        yuv420_planarize(buf, (int)config.frame_width, (int)config.frame_height, layout, yuv420_scratch);
+        size = size / 4 * 3;
+    } else if (config.pixformat == PIXFORMAT_RGB565 && video_format == UVC_FORMAT_YUY2) {
+        // Convert in place right behind the LCD push. RGBP goes out as captured.
+        for (size_t off = 0; off < config.image_buf_size; off += VIDEO_LCD_CHUNK) {
+            size_t len = MIN(VIDEO_LCD_CHUNK, config.image_buf_size - off);
+            video_lcd_wait(off + len);
+            rgb565_to_yuv422((void *)(buf + off), (int)(len / 4));
         }
+    } else if (config.pixformat == PIXFORMAT_GRAYSCALE) {
+        // Pack the Y bytes into the front half, behind the LCD push like above.
+        for (size_t off = 0; off < config.image_buf_size; off += VIDEO_LCD_CHUNK) {
+            size_t len = MIN(VIDEO_LCD_CHUNK, config.image_buf_size - off);
+            video_lcd_wait(off + len);
+            yuv422_to_y8((void *)(buf + off), buf + off / 2, (int)(len / 4));
+        }
+        size /= 2;
+    }
+    video_stats_end(STAGE_CONVERT);
+    video_lcd_wait(config.image_buf_size);
+    video_stats_end(STAGE_LCD);
+
+    video_stats_xfer_begin(frame);
+    tx_frame = frame;
+#ifdef USE_FREERTOS
+    video_xfer_buf = buf;
+    video_xfer_size = size;
+    video_xfer_queued = true;
+    usbd_defer_func(video_xfer_start, NULL, false);
+#else
+    if (!tud_video_n_frame_xfer(0, 0, (void *)buf, size)) {
+        tx_frame = NULL;
+        tx_busy = 0;
+        ov2640_capture_release_frame(&config, frame);
+    }
+#endif
+}
+
+// Apply a format and frame size committed by the host, once the UVC transfer has
+// handed the frame buffer back. Capture restarts in the new mode from the next VSYNC.
+static void video_mode_update(void) {
+    unsigned mode = video_mode_pending;
+    if (mode == 0 || tx_busy)
+        return;
+    video_mode_pending = 0;
+
+    unsigned idx = mode & 0xff;
+    unsigned format = mode >> 8;
+    pixformat_t pixformat = format == UVC_FORMAT_MJPEG  ? PIXFORMAT_JPEG
+                            : format == UVC_FORMAT_GREY ? PIXFORMAT_GRAYSCALE
+                            : format == UVC_FORMAT_RGBP ? PIXFORMAT_RGB565
+                                                        : VIDEO_RAW_PIXFORMAT;
+    const struct video_frame_size *size = pixformat == PIXFORMAT_JPEG ? &video_mjpeg_frame_sizes[idx - 1]
+                                                                      : &video_frame_sizes[idx - 1];
+    uint width = size->width;
+    uint height = size->height;
+    if (pixformat != PIXFORMAT_JPEG && width * height * 2 > sizeof(image_buf))
+        return;
+
+    // YUY2, NV12 and I420 share the sensor mode, only the conversion changes.
+    video_format = format;
+    if (pixformat != config.pixformat || width != config.frame_width || height != config.frame_height) {
+        video_lcd_wait(config.image_buf_size);
+        ov2640_capture_stop(&config);
+        ov2640_set_mode(&config, pixformat, width, height);
+        if (pixformat != PIXFORMAT_JPEG)
+            ili9341_show_frame_size((uint16_t)width, (uint16_t)height);
+        ov2640_capture_start(&config);
+    }
+#ifdef USE_FREERTOS
+    // The committed frame interval paces from here, not on the old mode's slots.
+    video_pacing_reset(&video_pacing);
+#endif
+    printf("video: %s %ux%u\n", video_format_names[format], width, height);
+}
+
+// The UVC transfer handed the frame back.
+static void video_xfer_done(void) {
+    video_stats_xfer_end();
+    tx_busy = 0;
+    if (tx_frame) {
+        ov2640_capture_release_frame(&config, tx_frame);
+        tx_frame = NULL;
+    }
+    ++frame_num;
+}
+
+#ifdef USE_FREERTOS
+static uint32_t video_notified; // notification bits received but not handled yet
+
+// Take whichever of the notification bits in mask have arrived, waiting up to
+// ticks for at least one of them. Returns the bits taken, 0 on timeout.
+static uint32_t video_notify_take(uint32_t mask, TickType_t ticks) {
+    uint32_t bits;
+    while (!(video_notified & mask)) {
+        if (!xTaskNotifyWait(0, UINT32_MAX, &bits, ticks))
+            return 0;
+        video_notified |= bits;
+    }
+    bits = video_notified & mask;
+    video_notified &= ~bits;
+    return bits;
+}
+#endif
+
+// tinyusb closes the streaming interface without calling the complete callback
+// for a transfer in flight, take its frame back when the host stops streaming.
+static void video_xfer_abort(void) {
+#ifdef USE_FREERTOS
+    // A transfer that did complete before the close has its notification queued.
+    if (video_notify_take(VIDEO_NOTIFY_XFER, 0)) {
+        video_xfer_done();
+        return;
+    }
+    // One still waiting for the USB task comes back through it.
+    if (video_xfer_queued)
+        return;
+#endif
+    if (!tx_busy)
+        return;
+    tx_busy = 0;
+    if (tx_frame) {
+        ov2640_capture_release_frame(&config, tx_frame);
+        tx_frame = NULL;
+    }
+}
+#endif
+
+#if CAPTURE_STRIPS
+// Push lines to the LCD as soon as the DMA has written them into the strip ring.
+static void video_strip_preview(void) {
+    static bool started = false;
+    const uint8_t *data;
+    int len;
+
+    if (!started) {
+        started = true;
+        ili9341_show_frame_begin();
+        ov2640_strip_start(&config, strip_ring, STRIP_RING_BITS);
+    }
+    while ((len = ov2640_strip_read(&config, &data)) > 0) {
         if (config.pixformat == PIXFORMAT_RGB565) {
-            ili9341_show_rgb565_data((void *)config.image_buf, (int)(config.image_buf_size / 2));
+            ili9341_show_rgb565_data((const uint16_t *)data, len / 2);
         } else if (config.pixformat == PIXFORMAT_YUV422) {
-            ili9341_show_yuv422_data((void *)config.image_buf, (int)(config.image_buf_size / 4));
+            ili9341_show_yuv422_data((const uint32_t *)data, len / 4);
+        }
+        if (!ov2640_strip_consume(&config, len)) {
+            len = -1;
+            break;
+        }
+    }
+    // An overrun, before or during the push, loses the rest of the frame: start
+    // over with the next one.
+    if (len < 0 || ov2640_strip_frame_done(&config))
+        started = false;
+}
+#endif
+
+void video_task(void) {
+
+#if CAPTURE_STRIPS
+#ifdef USE_FREERTOS
+    do {
+        video_strip_preview();
+        vTaskDelay(1);
+    } while (1);
+#else
+    video_strip_preview();
+#endif
+#elif defined(USE_FREERTOS)
+    ov2640_capture_start(&config);
+    video_pacing_reset(&video_pacing);
+    do {
+        struct ov2640_frame *frame;
+        video_pacing_wait(&video_pacing, interval_us);
+        if (video_notify_take(VIDEO_NOTIFY_XFER, 0))
+            video_xfer_done();
+        if (!tud_video_n_streaming(0, 0))
+            video_xfer_abort();
+        video_mode_update();
+        video_stats_begin();
+        // With a single frame buffer the next frame is only captured once the
+        // transfer hands the last one back, so take that in here as well. A host
+        // that stops streaming never completes it, poll for that.
+        while ((frame = ov2640_capture_get_frame(&config)) == NULL) {
+            uint32_t bits = video_notify_take(VIDEO_NOTIFY_FRAME | VIDEO_NOTIFY_XFER, pdMS_TO_TICKS(100));
+            if (bits & VIDEO_NOTIFY_XFER)
+                video_xfer_done();
+            else if (!bits && !tud_video_n_streaming(0, 0))
+                video_xfer_abort();
+        }
+        video_stats_end(STAGE_CAPTURE);
+        if (frame->lines < config.frame_height) {
+            ov2640_capture_release_frame(&config, frame);
+            continue;
         }
-        vTaskSuspendAll();
-        if (tud_video_n_streaming(0, 0)) {
-            if (config.pixformat == PIXFORMAT_RGB565) {
-                rgb565_to_yuv422((void *)config.image_buf, (int)(config.image_buf_size / 4));
-            }
 
-            tud_video_n_frame_xfer(0, 0, (void *)config.image_buf, config.image_buf_size);
+        video_frame_show(frame);
+        if (tx_busy && video_notify_take(VIDEO_NOTIFY_XFER, 0))
+            video_xfer_done();
+        if (tud_video_n_streaming(0, 0) && !tx_busy) {
+            tx_busy = 1;
+            video_frame_send(frame);
+        } else {
+            if (tx_busy)
+                video_pacing.dropped++;
+            ov2640_capture_release_frame(&config, frame);
         }
-        xTaskResumeAll();
     } while (1);
 #else
     static unsigned start_ms = 0;
     static unsigned already_sent = 0;
+    if (!tud_video_n_streaming(0, 0))
+        video_xfer_abort();
+    video_mode_update();
     if (!tud_video_n_streaming(0, 0)) {
         already_sent = 0;
         frame_num = 0;
         return;
     }
-    if(config.pixformat == PIXFORMAT_JPEG)
-    {
-        cam_verify_jpeg_eoi(config.image_buf, (int)config.image_buf_size);
-        cam_verify_jpeg_soi(config.image_buf, (int)config.image_buf_size);
+    if (already_sent) {
+        unsigned cur = board_millis();
+        if (cur - start_ms < interval_ms)
+            return; // not enough time
+        if (tx_busy)
+            return;
     }
-    if (!already_sent) {
-        already_sent = 1;
-        tx_busy = 1;
-        start_ms = board_millis();
-        ov2640_capture_frame(&config);
-        if (config.pixformat == PIXFORMAT_RGB565) {
-            ili9341_show_rgb565_data((void *)config.image_buf, (int)(config.image_buf_size / 2));
-            rgb565_to_yuv422((void *)config.image_buf, (int)(config.image_buf_size / 4));
-        } else if (config.pixformat == PIXFORMAT_YUV422) {
-            ili9341_show_yuv422_data((void *)config.image_buf, (int)(config.image_buf_size / 4));
-        }
 
-        tud_video_n_frame_xfer(0, 0, (void *)config.image_buf, config.image_buf_size );
+    video_stats_begin();
+    struct ov2640_frame *frame = ov2640_capture_get_frame(&config);
+    if (frame == NULL)
+        return; // still capturing, keep servicing USB meanwhile
+    video_stats_end(STAGE_CAPTURE);
+    if (frame->lines < config.frame_height) {
+        ov2640_capture_release_frame(&config, frame); // truncated, wait for the next one
         return;
     }
 
-    unsigned cur = board_millis();
-    if (cur - start_ms < interval_ms)
-        return; // not enough time
-    if (tx_busy)
-        return;
-    tx_busy = 1;
-
-    start_ms += interval_ms;
-    ov2640_capture_frame(&config);
-    if (config.pixformat == PIXFORMAT_RGB565) {
-        ili9341_show_rgb565_data((void *)config.image_buf, (int)(config.image_buf_size / 2));
-
-    } else if (config.pixformat == PIXFORMAT_YUV422) {
-        ili9341_show_yuv422_data((void *)config.image_buf, (int)(config.image_buf_size / 4));
+    if (!already_sent) {
+        already_sent = 1;
+        start_ms = board_millis();
+    } else {
+        start_ms += interval_ms;
     }
+    tx_busy = 1;
 
-    tud_video_n_frame_xfer(0, 0, (void *)config.image_buf, config.image_buf_size);
+    video_frame_show(frame);
+    video_frame_send(frame);
 #endif
 }
 
 void tud_video_frame_xfer_complete_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx) {
     (void)ctl_idx;
     (void)stm_idx;
-    tx_busy = 0;
-    /* flip buffer */
-    ++frame_num;
+    video_stats_xfer_complete();
+#if CAPTURE_STRIPS
+    // Nothing is queued on the stream in strip mode.
+#elif defined(USE_FREERTOS)
+    // The camera task owns tx_busy, tx_frame and video_stats, hand the frame back to it.
+    xTaskNotify(cam_taskhandle, VIDEO_NOTIFY_XFER, eSetBits);
+#else
+    video_xfer_done();
+#endif
 }
 
 int tud_video_commit_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx,
@@ -304,6 +854,12 @@ int tud_video_commit_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx,
     (void)stm_idx;
     /* convert unit to ms from 100 ns */
     interval_ms = parameters->dwFrameInterval / 10000;
+    interval_us = parameters->dwFrameInterval / 10;
+    printf("uvc: commit format %u frame %u, %u byte payloads\n", parameters->bFormatIndex,
+           parameters->bFrameIndex, (unsigned)parameters->dwMaxPayloadTransferSize);
+    unsigned count = parameters->bFormatIndex == UVC_FORMAT_MJPEG ? UVC_MJPEG_FRAME_COUNT : UVC_FRAME_COUNT;
+    if (parameters->bFrameIndex >= 1 && parameters->bFrameIndex <= count)
+        video_mode_pending = parameters->bFormatIndex << 8 | parameters->bFrameIndex;
 
     return VIDEO_ERROR_NONE;
 }
@@ -332,6 +888,34 @@ void led_blinking_task(void) {
 #ifdef USE_FREERTOS
 void vApplicationTickHook(void){};
 
+// Kernel task memory for configSUPPORT_STATIC_ALLOCATION.
+void vApplicationGetIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack, configSTACK_DEPTH_TYPE *depth) {
+    static StaticTask_t idle_tcb;
+    static StackType_t idle_stack[configMINIMAL_STACK_SIZE];
+    *tcb = &idle_tcb;
+    *stack = idle_stack;
+    *depth = configMINIMAL_STACK_SIZE;
+}
+
+#if configNUMBER_OF_CORES > 1
+void vApplicationGetPassiveIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack, configSTACK_DEPTH_TYPE *depth,
+                                          BaseType_t index) {
+    static StaticTask_t idle_tcb[configNUMBER_OF_CORES - 1];
+    static StackType_t idle_stack[configNUMBER_OF_CORES - 1][configMINIMAL_STACK_SIZE];
+    *tcb = &idle_tcb[index];
+    *stack = idle_stack[index];
+    *depth = configMINIMAL_STACK_SIZE;
+}
+#endif
+
+void vApplicationGetTimerTaskMemory(StaticTask_t **tcb, StackType_t **stack, configSTACK_DEPTH_TYPE *depth) {
+    static StaticTask_t timer_tcb;
+    static StackType_t timer_stack[configTIMER_TASK_STACK_DEPTH];
+    *tcb = &timer_tcb;
+    *stack = timer_stack;
+    *depth = configTIMER_TASK_STACK_DEPTH;
+}
+
 void vApplicationStackOverflowHook(TaskHandle_t Task, char *pcTaskName) {
     panic("stack overflow (not the helpful kind) for %s\n", *pcTaskName);
 }
@@ -1,22 +1,78 @@
 #include "ov2640.h"
 #include "hardware/dma.h"
+#include "hardware/gpio.h"
 #include "hardware/i2c.h"
+#include "hardware/irq.h"
+#include "hardware/pio_instructions.h"
+#include "hardware/sync.h"
+#include "frame_pool.h"
 #include "image.pio.h"
 #include "ov2640_init.h"
 #include "usb_descriptors.h"
 #include <stdio.h>
+#include <string.h>
 
 #define OV2640_ADDR 0x30
 
 struct ov2640_config *vconfig = NULL;
+static uint image_offset;
+
+static void ov2640_capture_init(struct ov2640_config *config);
+static size_t ov2640_frame_bytes(struct ov2640_config *config);
+static void ov2640_capture_program_init(struct ov2640_config *config);
 
 // #define PIN_PWND   -1  // Also called PWDN, or set to -1 and tie to GND
 
+// Shadow copy of the DSP and sensor register banks. Register tables are replayed
+// through it, so a format or size change only writes the registers that differ.
+static struct {
+    uint8_t regs[2][256];
+    uint32_t valid[2][256 / 32];
+    int bank; // last BANK_SEL written, -1 when unknown
+    uint32_t writes;
+    uint32_t skipped;
+} sccb_shadow = {.bank = -1};
+
+static void ov2640_shadow_invalidate(void) {
+    memset(sccb_shadow.valid, 0, sizeof(sccb_shadow.valid));
+    sccb_shadow.bank = -1;
+}
+
+// RESET and MC_BIST trigger actions in the DSP, they are always written.
+static bool ov2640_reg_is_action(int bank, uint8_t reg) {
+    return bank == BANK_SEL_DSP && (reg == RESET || reg == MC_BIST);
+}
+
 static void
 ov2640_reg_write(uint8_t reg, uint8_t value) {
+    int bank = sccb_shadow.bank;
+
+    if (reg == BANK_SEL) {
+        if (bank == (value & 1)) {
+            sccb_shadow.skipped++;
+            return;
+        }
+    } else if (bank >= 0 && !ov2640_reg_is_action(bank, reg) &&
+               (sccb_shadow.valid[bank][reg / 32] & (1u << (reg % 32))) &&
+               sccb_shadow.regs[bank][reg] == value) {
+        sccb_shadow.skipped++;
+        return;
+    }
+
     // printf("write reg: 0x%02x, value: 0x%02x\n", reg, value);
     i2c_write_blocking(vconfig->sccb, OV2640_ADDR, (uint8_t[]){reg, value}, 2, false);
-    sleep_ms(1);
+    sccb_shadow.writes++;
+
+    if (reg == BANK_SEL) {
+        sccb_shadow.bank = value & 1;
+    } else if (bank == BANK_SEL_SENS && reg == COM7 && (value & COM7_SRST)) {
+        // All registers go back to their defaults, give the sensor time to reset.
+        sleep_ms(5);
+        ov2640_shadow_invalidate();
+    } else if (bank >= 0) {
+        sccb_shadow.regs[bank][reg] = value;
+        sccb_shadow.valid[bank][reg / 32] |= 1u << (reg % 32);
+    }
 }
 
 // v4l2-ctl --stream-mmap=0 --stream-count=1 --stream-to=test.jpg
@@ -30,8 +86,8 @@ static uint8_t ov2640_reg_read(uint8_t reg) {
 
 /* Select the nearest higher resolution for capture */
 static const struct ov2640_win_size *ov2640_select_win(uint32_t width, uint32_t height) {
-    int i, default_size = 7;
-    for (i = 0; i < 8; i++) {
+    int i, default_size = count_of(ov2640_supported_win_sizes) - 1;
+    for (i = 0; i < (int)count_of(ov2640_supported_win_sizes); i++) {
         if (ov2640_supported_win_sizes[i].width >= width &&
             ov2640_supported_win_sizes[i].height >= height)
             return &ov2640_supported_win_sizes[i];
@@ -48,10 +104,10 @@ static void ov2640_regs_write(const OV2640_command *cmd) {
     }
 }
 
-void ov2640_set_params(struct ov2640_config *config) {
-    ov2640_regs_write(ov2640_init_regs);
+// Window and pixel format, written on top of ov2640_init_regs.
+static void ov2640_write_mode(struct ov2640_config *config) {
     ov2640_regs_write(ov2640_size_change_preamble_regs);
-    const struct ov2640_win_size *win = ov2640_select_win(320, 240);
+    const struct ov2640_win_size *win = ov2640_select_win(config->frame_width, config->frame_height);
     ov2640_regs_write(win->regs);
     ov2640_regs_write(ov2640_format_change_preamble_regs);
 
@@ -61,6 +117,7 @@ void ov2640_set_params(struct ov2640_config *config) {
             // ov2640_regs_write(ov2640_rgb565_le_regs);
             break;
         case PIXFORMAT_YUV422:
+        case PIXFORMAT_GRAYSCALE: // YUV422 on the wire, the consumer keeps the Y bytes
             ov2640_regs_write(ov2640_uyvy_regs); // Transmission to Linux system via UVC displays normally.
             // ov2640_regs_write(ov2640_yuyv_regs);
             break;
@@ -73,13 +130,25 @@ void ov2640_set_params(struct ov2640_config *config) {
     }
 }
 
+static void ov2640_sccb_report(uint32_t writes, uint32_t skipped) {
+    printf("sccb: %u writes, %u skipped\n", (unsigned)(sccb_shadow.writes - writes),
+           (unsigned)(sccb_shadow.skipped - skipped));
+}
+
+void ov2640_set_params(struct ov2640_config *config) {
+    uint32_t writes = sccb_shadow.writes, skipped = sccb_shadow.skipped;
+
+    ov2640_regs_write(ov2640_init_regs);
+    ov2640_write_mode(config);
+    ov2640_sccb_report(writes, skipped);
+}
+
 static bool ov2640_probe(struct ov2640_config *config)
 {
     (void *)config;
     uint16_t reg = 0;
     ov2640_reg_write(BANK_SEL, BANK_SEL_SENS);
-    ov2640_reg_write(COM7, 0x80); // soft reset
-    sleep_ms(1000);
+    ov2640_reg_write(COM7, COM7_SRST); // soft reset, waits for the sensor
     reg = ov2640_reg_read(MIDH);
     reg <<= 8;
     reg |= ov2640_reg_read(MIDL);
@@ -93,8 +162,8 @@ static bool ov2640_probe(struct ov2640_config *config)
 
 void ov2640_init(struct ov2640_config *config) {
     vconfig = config;
-    // SCCB I2C @ 100 kHz
-    i2c_init(config->sccb, 100 * 1000);
+    // SCCB I2C @ 400 kHz, the fastest the OV2640 supports
+    i2c_init(config->sccb, 400 * 1000);
     gpio_set_function(config->pin_sioc, GPIO_FUNC_I2C);
     gpio_set_function(config->pin_siod, GPIO_FUNC_I2C);
     gpio_pull_up(PICO_DEFAULT_I2C_SDA_PIN);
@@ -112,40 +181,369 @@ void ov2640_init(struct ov2640_config *config) {
     ov2640_probe(config);
     ov2640_set_params(config);
 
-    uint offset = pio_add_program(config->pio, &image_program);
-    image_program_init(config->pio, config->pio_sm, offset, config->pin_y2_pio_base);
+    if (config->image_buf_capacity == 0)
+        config->image_buf_capacity = config->image_buf_size;
+    config->image_buf_size = ov2640_frame_bytes(config);
+    image_offset = image_program_load(config->pio, config->pin_vsync);
+    ov2640_capture_init(config);
+    ov2640_capture_program_init(config);
+}
+
+#if OV2640_MAX_FRAME_BUFS > FRAME_POOL_MAX_BUFS
+#error "OV2640_MAX_FRAME_BUFS must fit in a frame_pool"
+#endif
+
+// Ownership of the frame buffers, shared between the capture interrupts and the
+// consumers, which may run on either core. Taken under capture_lock.
+static struct {
+    struct ov2640_frame frames[OV2640_MAX_FRAME_BUFS];
+    struct frame_pool pool; // pool.capturing is the buffer the DMA is writing
+    volatile bool running;
+    volatile uint32_t frames_captured;
+    volatile uint32_t frames_truncated;
+    // VSYNC to VSYNC periods in us, sampled on every rising edge whether or not a
+    // frame is captured; see ov2640_vsync_periods().
+    uint32_t vsync_last_us;
+    uint32_t vsync_periods[OV2640_VSYNC_RING];
+    uint32_t vsync_count; // periods recorded since the last ov2640_vsync_periods()
+    uint32_t vsync_head;
+} capture = {.pool = {.capturing = -1}};
+
+// Line-strip capture state, see ov2640_strip_start().
+static struct {
+    uint8_t *ring;
+    uint32_t ring_mask;
+    size_t consumed;
+    volatile bool active;
+    volatile bool frame_done;
+} strip;
+
+static dma_channel_config capture_dma_config;
+static spin_lock_t *capture_lock;
+
+static void ov2640_capture_done(struct ov2640_config *config, bool at_vsync);
+
+// Drop whatever a stalled state machine still holds and park it at its VSYNC
+// wait, so the first FIFO word of the next frame starts with its first pixel byte.
+// at_vsync: called on a VSYNC rising edge, skip straight to the first line wait.
+static void ov2640_sm_rewind(struct ov2640_config *config, bool at_vsync) {
+    PIO pio = config->pio;
+    uint sm = config->pio_sm;
+    pio_sm_set_enabled(pio, sm, false);
+    pio_sm_clear_fifos(pio, sm);
+    pio_sm_restart(pio, sm);
+    if (at_vsync) {
+        pio_sm_exec(pio, sm, pio_encode_mov(pio_y, pio_x));
+        pio_sm_exec(pio, sm, pio_encode_jmp(image_offset + image_offset_line));
+    } else {
+        pio_sm_exec(pio, sm, pio_encode_jmp(image_offset));
+    }
+}
+
+// Pick a free buffer, point the DMA at it and restart the state machine at its
+// VSYNC wait. Called with capture_lock held.
+static void ov2640_capture_arm(struct ov2640_config *config, bool at_vsync) {
+    if (!capture.running || capture.pool.capturing >= 0)
+        return;
+
+    int i = frame_pool_capture(&capture.pool);
+    if (i < 0) {
+        // No buffer to write to: stop the state machine rather than let it stall
+        // half way into a frame, the next arm restarts it at a frame boundary.
+        pio_sm_set_enabled(config->pio, config->pio_sm, false);
+        return;
+    }
+    ov2640_sm_rewind(config, at_vsync);
+    dma_channel_set_write_addr(config->dma_channel, config->image_bufs[i], false);
+    dma_channel_set_trans_count(config->dma_channel, config->image_buf_size / 4, true);
+    pio_sm_set_enabled(config->pio, config->pio_sm, true);
+}
+
+// End of frame, raised by image.pio once it has counted frame_height lines.
+static void ov2640_pio_irq_handler(void) {
+    PIO pio = vconfig->pio;
+    uint sm = vconfig->pio_sm;
+    uint ch = vconfig->dma_channel;
+
+    if (!pio_interrupt_get(pio, sm))
+        return;
+    pio_interrupt_clear(pio, sm);
+
+    if (strip.active) {
+        // Park the state machine until the consumer starts the next frame.
+        while (dma_channel_is_busy(ch) && !pio_sm_is_rx_fifo_empty(pio, sm))
+            tight_loop_contents();
+        pio_sm_set_enabled(pio, sm, false);
+        if (dma_channel_is_busy(ch))
+            dma_channel_abort(ch); // truncated frame
+        strip.active = false;
+        strip.frame_done = true;
+        return;
+    }
+
+    uint32_t status = spin_lock_blocking(capture_lock);
+    if (capture.pool.capturing >= 0)
+        ov2640_capture_done(vconfig, false);
+    spin_unlock(capture_lock, status);
+}
+
+static bool ov2640_capture_empty(struct ov2640_config *config) {
+    return dma_channel_hw_addr(config->dma_channel)->transfer_count == config->image_buf_size / 4 &&
+           pio_sm_is_rx_fifo_empty(config->pio, config->pio_sm);
+}
+
+// Time stamps the frame starting at this VSYNC rising edge and records the VSYNC
+// period. JPEG frames also end here instead of on a line count.
+static void ov2640_vsync_irq_handler(void) {
+    PIO pio = vconfig->pio;
+    uint sm = vconfig->pio_sm;
+
+    if (!(gpio_get_irq_event_mask(vconfig->pin_vsync) & GPIO_IRQ_EDGE_RISE))
+        return;
+    gpio_acknowledge_irq(vconfig->pin_vsync, GPIO_IRQ_EDGE_RISE);
+    uint32_t now = time_us_32();
+    uint32_t status = spin_lock_blocking(capture_lock);
+
+    if (capture.vsync_last_us) {
+        capture.vsync_periods[capture.vsync_head] = now - capture.vsync_last_us;
+        capture.vsync_head = (capture.vsync_head + 1) % OV2640_VSYNC_RING;
+        capture.vsync_count++;
+    }
+    capture.vsync_last_us = now | 1; // 0 means no edge yet
+
+    // Something captured: the SM was not only just started at this same edge.
+    if (vconfig->pixformat == PIXFORMAT_JPEG && capture.pool.capturing >= 0 && !ov2640_capture_empty(vconfig)) {
+        // Flush the last 1-3 bytes left in the ISR. They sit in its top bytes, so
+        // shift zeros in behind them until autopush fires: a partial word goes out
+        // once with its bytes in order, an empty ISR pushes nothing.
+        pio_sm_set_enabled(pio, sm, false);
+        for (int i = 0; i < 3; i++)
+            pio_sm_exec(pio, sm, pio_encode_in(pio_null, 8));
+        ov2640_capture_done(vconfig, true);
+    }
+    if (capture.pool.capturing >= 0 && ov2640_capture_empty(vconfig))
+        capture.frames[capture.pool.capturing].vsync_us = now;
+    spin_unlock(capture_lock, status);
 }
 
-void ov2640_capture_frame(struct ov2640_config *config) {
-    // config->dma_channel = dma_claim_unused_channel(true);
+// Hand the frame the DMA was writing to the consumer and start the next one.
+// Called with capture_lock held.
+static void ov2640_capture_done(struct ov2640_config *config, bool at_vsync) {
+    PIO pio = config->pio;
+    uint sm = config->pio_sm;
+    uint ch = config->dma_channel;
+    int idx = capture.pool.capturing;
+
+    // The last word can still be on its way from the FIFO to memory.
+    while (dma_channel_is_busy(ch) && !pio_sm_is_rx_fifo_empty(pio, sm))
+        tight_loop_contents();
+    uint32_t remaining = dma_channel_hw_addr(ch)->transfer_count;
+    if (dma_channel_is_busy(ch))
+        dma_channel_abort(ch);
+
+    struct ov2640_frame *frame = &capture.frames[idx];
+    frame->done_us = time_us_32();
+    frame->len = config->image_buf_size - remaining * 4;
+    if (config->pixformat == PIXFORMAT_JPEG) {
+        frame->lines = config->frame_height; // checked by its SOI/EOI markers instead
+    } else {
+        frame->lines = frame->len / (config->image_buf_size / config->frame_height);
+        if (frame->lines < config->frame_height)
+            capture.frames_truncated++;
+    }
+
+    // Only the newest frame is worth sending, it replaces one the consumer never took.
+    frame_pool_ready(&capture.pool);
+    capture.frames_captured++;
+
+    ov2640_capture_arm(config, at_vsync);
+    if (config->frame_ready_cb)
+        config->frame_ready_cb(config);
+}
+
+static void ov2640_capture_init(struct ov2640_config *config) {
+    for (uint i = 0; i < config->image_buf_count; i++)
+        capture.frames[i].buf = config->image_bufs[i];
+    frame_pool_init(&capture.pool, config->image_buf_count);
+    capture_lock = spin_lock_init(spin_lock_claim_unused(true));
+
+    dma_channel_claim(config->dma_channel);
     dma_channel_config c = dma_channel_get_default_config(config->dma_channel);
-    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    // image.pio autopushes whole words, frame buffers must be word aligned.
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
     channel_config_set_read_increment(&c, false);
     channel_config_set_write_increment(&c, true);
     channel_config_set_dreq(&c, pio_get_dreq(config->pio, config->pio_sm, false));
+    capture_dma_config = c;
 
     dma_channel_configure(
         config->dma_channel, &c,
-        config->image_buf,
+        config->image_bufs[0],
         &config->pio->rxf[config->pio_sm],
-        config->image_buf_size,
+        config->image_buf_size / 4,
         false);
 
-    // Wait for vsync rising edge to start frame
-    while (gpio_get(config->pin_vsync) == true)
-        ;
-    while (gpio_get(config->pin_vsync) == false)
-        ;
+    uint irq = pio_get_index(config->pio) ? PIO1_IRQ_0 : PIO0_IRQ_0;
+    pio_set_irq0_source_enabled(config->pio, pis_interrupt0 + config->pio_sm, true);
+    irq_set_exclusive_handler(irq, ov2640_pio_irq_handler);
+    irq_set_enabled(irq, true);
+
+    gpio_add_raw_irq_handler(config->pin_vsync, ov2640_vsync_irq_handler);
+    gpio_set_irq_enabled(config->pin_vsync, GPIO_IRQ_EDGE_RISE, true);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+}
+
+void ov2640_capture_start(struct ov2640_config *config) {
+    uint32_t status = spin_lock_blocking(capture_lock);
+    dma_channel_set_config(config->dma_channel, &capture_dma_config, false);
+    capture.running = true;
+    ov2640_capture_arm(config, false);
+    spin_unlock(capture_lock, status);
+}
+
+// Bytes the DMA may write per frame: JPEG frames vary in size and get the whole buffer.
+static size_t ov2640_frame_bytes(struct ov2640_config *config) {
+    if (config->pixformat == PIXFORMAT_JPEG)
+        return config->image_buf_capacity;
+    return config->frame_width * config->frame_height * 2;
+}
+
+// JPEG frames are ended from the VSYNC interrupt, the SM never runs out of lines.
+// Raw lines are realigned to a word each, JPEG bytes run on across lines.
+static void ov2640_capture_program_init(struct ov2640_config *config) {
+    bool jpeg = config->pixformat == PIXFORMAT_JPEG;
+    image_program_init(config->pio, config->pio_sm, image_offset, config->pin_y2_pio_base,
+                       jpeg ? 0 : config->frame_height, !jpeg);
+}
+
+void ov2640_set_mode(struct ov2640_config *config, pixformat_t pixformat, uint width, uint height) {
+    uint32_t writes = sccb_shadow.writes, skipped = sccb_shadow.skipped;
+    uint32_t status = spin_lock_blocking(capture_lock);
+
+    // Frames captured in the old mode are of no use any more.
+    frame_pool_flush(&capture.pool);
+    config->pixformat = pixformat;
+    config->frame_width = width;
+    config->frame_height = height;
+    config->image_buf_size = ov2640_frame_bytes(config);
+    spin_unlock(capture_lock, status);
 
-    dma_channel_start(config->dma_channel);
-    dma_channel_wait_for_finish_blocking(config->dma_channel);
+    ov2640_write_mode(config);
+    ov2640_sccb_report(writes, skipped);
+    ov2640_capture_program_init(config);
+}
+
+void ov2640_capture_stop(struct ov2640_config *config) {
+    uint32_t status = spin_lock_blocking(capture_lock);
+    capture.running = false;
+    pio_sm_set_enabled(config->pio, config->pio_sm, false);
+    if (capture.pool.capturing >= 0) {
+        dma_channel_abort(config->dma_channel);
+        frame_pool_abort(&capture.pool);
+    }
+    spin_unlock(capture_lock, status);
+}
+
+struct ov2640_frame *ov2640_capture_get_frame(struct ov2640_config *config) {
+    (void)config;
+    uint32_t status = spin_lock_blocking(capture_lock);
+    int i = frame_pool_get(&capture.pool);
+    spin_unlock(capture_lock, status);
+    return i < 0 ? NULL : &capture.frames[i];
+}
 
+// Buffer index of a frame handed out by ov2640_capture_get_frame(), -1 if it is none.
+static int ov2640_frame_index(struct ov2640_config *config, struct ov2640_frame *frame) {
+    for (uint i = 0; i < config->image_buf_count; i++) {
+        if (&capture.frames[i] == frame)
+            return (int)i;
+    }
+    return -1;
+}
+
+void ov2640_capture_ref_frame(struct ov2640_config *config, struct ov2640_frame *frame) {
+    int i = ov2640_frame_index(config, frame);
+    uint32_t status = spin_lock_blocking(capture_lock);
+    if (i >= 0)
+        frame_pool_ref(&capture.pool, (uint)i);
+    spin_unlock(capture_lock, status);
+}
+
+void ov2640_capture_release_frame(struct ov2640_config *config, struct ov2640_frame *frame) {
+    int i = ov2640_frame_index(config, frame);
+    uint32_t status = spin_lock_blocking(capture_lock);
+    if (i >= 0)
+        frame_pool_release(&capture.pool, (uint)i);
+    ov2640_capture_arm(config, false);
+    spin_unlock(capture_lock, status);
+}
+
+uint ov2640_vsync_periods(struct ov2640_config *config, uint32_t *periods, uint max) {
+    (void)config;
+    uint32_t status = spin_lock_blocking(capture_lock);
+    uint n = MIN(MIN(capture.vsync_count, OV2640_VSYNC_RING), max);
+    for (uint i = 0; i < n; i++)
+        periods[i] = capture.vsync_periods[(capture.vsync_head - n + i) % OV2640_VSYNC_RING];
+    capture.vsync_count = 0;
+    spin_unlock(capture_lock, status);
+    return n;
+}
+
+struct ov2640_frame *ov2640_capture_frame(struct ov2640_config *config) {
+    struct ov2640_frame *frame;
+    if (!capture.running)
+        ov2640_capture_start(config);
+    while ((frame = ov2640_capture_get_frame(config)) == NULL)
+        tight_loop_contents();
+    return frame;
+}
+
+void ov2640_strip_start(struct ov2640_config *config, uint8_t *ring, uint ring_bits) {
+    uint32_t status = spin_lock_blocking(capture_lock);
+    strip.ring = ring;
+    strip.ring_mask = (1u << ring_bits) - 1;
+    strip.consumed = 0;
+    strip.frame_done = false;
+    strip.active = true;
+
+    // Same transfer as a full frame, but the write address wraps inside the ring.
+    dma_channel_config c = capture_dma_config;
+    channel_config_set_ring(&c, true, ring_bits);
+
+    ov2640_sm_rewind(config, false);
     dma_channel_abort(config->dma_channel);
-    dma_channel_unclaim(config->dma_channel);
+    dma_channel_configure(
+        config->dma_channel, &c,
+        ring,
+        &config->pio->rxf[config->pio_sm],
+        config->image_buf_size / 4,
+        true);
+    pio_sm_set_enabled(config->pio, config->pio_sm, true);
+    spin_unlock(capture_lock, status);
+}
 
-#if 0
-    irq_set_exclusive_handler(DMA_IRQ_0, dma_complete_handler);
-    dma_channel_set_irq0_enabled(DMA_CHANNEL, true);
-    irq_set_enabled(DMA_IRQ_0, true);
-#endif
+int ov2640_strip_read(struct ov2640_config *config, const uint8_t **data) {
+    size_t produced = config->image_buf_size - dma_channel_hw_addr(config->dma_channel)->transfer_count * 4;
+    size_t avail = produced - strip.consumed;
+    if (avail > strip.ring_mask + 1)
+        return -1; // the DMA lapped us, the unread lines are gone
+
+    size_t offset = strip.consumed & strip.ring_mask;
+    size_t contiguous = strip.ring_mask + 1 - offset;
+    *data = strip.ring + offset;
+    return (int)(avail < contiguous ? avail : contiguous);
+}
+
+bool ov2640_strip_consume(struct ov2640_config *config, size_t len) {
+    // The bytes just used were still intact only if the DMA has not come round
+    // to them again while they were being read.
+    size_t produced = config->image_buf_size - dma_channel_hw_addr(config->dma_channel)->transfer_count * 4;
+    bool intact = produced - strip.consumed <= strip.ring_mask + 1;
+    strip.consumed += len;
+    return intact;
+}
+
+bool ov2640_strip_frame_done(struct ov2640_config *config) {
+    size_t produced = config->image_buf_size - dma_channel_hw_addr(config->dma_channel)->transfer_count * 4;
+    return strip.frame_done && strip.consumed >= produced;
 }
@@ -6,6 +6,18 @@
 #include "ov2640_init.h"
 #include <stdint.h>
 
+#define OV2640_MAX_FRAME_BUFS 3
+// VSYNC periods kept by the VSYNC interrupt, a power of 2.
+#define OV2640_VSYNC_RING 32
+
+struct ov2640_frame {
+    uint8_t *buf;
+    size_t len;  // bytes written by the capture DMA, the JPEG size in JPEG mode
+    uint lines;  // complete lines captured, fewer than frame_height when truncated
+    uint32_t vsync_us; // time_us_32() at the VSYNC rising edge the frame started on
+    uint32_t done_us;  // time_us_32() when the capture DMA was stopped
+};
+
 struct ov2640_config {
     i2c_inst_t *sccb;
     uint pin_sioc;
@@ -21,14 +33,59 @@ struct ov2640_config {
     uint pio_sm;
 
     uint dma_channel;
-    uint8_t *image_buf;
+    uint frame_width;
+    uint frame_height;
+    // Word aligned frame buffers of image_buf_capacity bytes each (a multiple of 4),
+    // the capture DMA rotates through the first image_buf_count of them.
+    // image_buf_size is how much of a buffer one frame may take, set from the mode.
+    uint8_t *image_bufs[OV2640_MAX_FRAME_BUFS];
+    uint image_buf_count;
     size_t image_buf_size;
+    size_t image_buf_capacity; // defaults to the initial image_buf_size
     pixformat_t pixformat;
+
+    // Invoked from the DMA interrupt each time a frame becomes ready, may be NULL.
+    void (*frame_ready_cb)(struct ov2640_config *config);
 };
 
 void ov2640_init(struct ov2640_config *config);
 
-void ov2640_capture_frame(struct ov2640_config *config);
+// Asynchronous capture: once started, every free frame buffer is filled from the
+// next VSYNC on, so frame N+1 is captured while frame N is still being consumed.
+void ov2640_capture_start(struct ov2640_config *config);
+void ov2640_capture_stop(struct ov2640_config *config);
+// Switch the sensor and the capture to another pixel format and width x height.
+// Capture must be stopped and no frame held. Uncompressed frames must fit in
+// image_buf_capacity; JPEG frames are as long as the sensor makes them.
+void ov2640_set_mode(struct ov2640_config *config, pixformat_t pixformat, uint width, uint height);
+// Take the most recent captured frame, NULL if none is ready yet. The frame
+// belongs to the caller until it is handed back with ov2640_capture_release_frame().
+// Further consumers of the same frame take their own reference with
+// ov2640_capture_ref_frame(); the buffer is captured into again once every
+// reference is released. Both may be called from either core or from an IRQ.
+struct ov2640_frame *ov2640_capture_get_frame(struct ov2640_config *config);
+void ov2640_capture_ref_frame(struct ov2640_config *config, struct ov2640_frame *frame);
+void ov2640_capture_release_frame(struct ov2640_config *config, struct ov2640_frame *frame);
+
+// Copy the last, at most max, VSYNC to VSYNC periods in us recorded since the
+// previous call into periods, oldest first, and return how many there were.
+uint ov2640_vsync_periods(struct ov2640_config *config, uint32_t *periods, uint max);
+
+// Blocking helper: start capturing if needed and wait for the next ready frame.
+struct ov2640_frame *ov2640_capture_frame(struct ov2640_config *config);
+
+// Line-strip capture: the next frame streams through a ring of 1 << ring_bits
+// bytes, aligned to its size, instead of a full frame buffer. The consumer reads
+// lines while the DMA is still writing the rest of the frame.
+void ov2640_strip_start(struct ov2640_config *config, uint8_t *ring, uint ring_bits);
+// Contiguous captured bytes at *data (a multiple of 4), or -1 once the DMA has
+// overwritten lines that were not consumed yet.
+int ov2640_strip_read(struct ov2640_config *config, const uint8_t **data);
+// Done with len bytes from ov2640_strip_read(). False if the DMA lapped the ring
+// while they were in use, what was read is then partly the next lines.
+bool ov2640_strip_consume(struct ov2640_config *config, size_t len);
+// True once the whole frame has been captured and consumed.
+bool ov2640_strip_frame_done(struct ov2640_config *config);
 
 void OV2640_JPEG_Mode(void);
 void OV2640_RGB565_Mode(void);
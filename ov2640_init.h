@@ -534,6 +534,11 @@ static const OV2640_command ov2640_size_change_preamble_regs[] = {
         {R_DVP_SP, pclk_div},                          \
     { RESET, 0x00 }
 
+static const  OV2640_command ov2640_qqvga_regs[] = {
+    PER_SIZE_REG_SEQ(QQVGA_WIDTH, QQVGA_HEIGHT, 3, 3, 4),
+    ENDMARKER,
+};
+
 static const  OV2640_command ov2640_qcif_regs[] = {
     PER_SIZE_REG_SEQ(QCIF_WIDTH, QCIF_HEIGHT, 3, 3, 4),
     ENDMARKER,
@@ -578,6 +583,7 @@ static const OV2640_command ov2640_uxga_regs[] = {
     { .name = n, .width = w, .height = h, .regs = r }
 
 static const struct ov2640_win_size ov2640_supported_win_sizes[] = {
+    OV2640_SIZE("QQVGA", QQVGA_WIDTH, QQVGA_HEIGHT, ov2640_qqvga_regs),
     OV2640_SIZE("QCIF", QCIF_WIDTH, QCIF_HEIGHT, ov2640_qcif_regs),
     OV2640_SIZE("QVGA", QVGA_WIDTH, QVGA_HEIGHT, ov2640_qvga_regs),
     OV2640_SIZE("CIF", CIF_WIDTH, CIF_HEIGHT, ov2640_cif_regs),
@@ -0,0 +1,628 @@
+/**
+ * State and behaviour of the pico-sdk model in hal_model.h.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "hal_model.h"
+#include "bsp/board_api.h"
+
+struct hal_model hal;
+pio_hw_t hal_pio_hw[2];
+i2c_inst_t hal_i2c[2];
+static dma_hw_t hal_dma_hw;
+dma_hw_t *const dma_hw = &hal_dma_hw;
+
+#define DREQ_PIO_TX(pio, sm) ((pio) * 8 + (sm))
+#define DREQ_PIO_RX(pio, sm) ((pio) * 8 + 4 + (sm))
+
+void hal_reset(void) {
+    memset(&hal, 0, sizeof(hal));
+    memset(hal_pio_hw, 0, sizeof(hal_pio_hw));
+    memset(hal_i2c, 0, sizeof(hal_i2c));
+    memset(&hal_dma_hw, 0, sizeof(hal_dma_hw));
+    hal.sys_hz = 125000000;
+    hal.tx_bytes_per_us = 8;
+}
+
+//--------------------------------------------------------------------+
+// Interrupts
+//--------------------------------------------------------------------+
+static void hal_irq_dispatch(void) {
+    uint32_t ready;
+
+    if (hal.in_irq || hal.irq_masked)
+        return;
+    while ((ready = hal.irq_pending & hal.irq_enabled) != 0) {
+        uint irq = (uint)__builtin_ctz(ready);
+        hal.irq_pending &= ~(1u << irq);
+        if (!hal.irq_handler[irq])
+            continue;
+        hal.in_irq = true;
+        hal.irq_handler[irq]();
+        hal.in_irq = false;
+    }
+}
+
+void hal_irq_raise(uint irq) {
+    hal.irq_pending |= 1u << irq;
+    hal_irq_dispatch();
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) {
+    hal.irq_handler[num] = handler;
+}
+
+void irq_set_enabled(uint num, bool enabled) {
+    if (enabled)
+        hal.irq_enabled |= 1u << num;
+    else
+        hal.irq_enabled &= ~(1u << num);
+    hal_irq_dispatch();
+}
+
+uint32_t save_and_disable_interrupts(void) {
+    hal.irq_masked++;
+    return 0;
+}
+
+void restore_interrupts(uint32_t status) {
+    (void)status;
+    hal.irq_masked--;
+    hal_irq_dispatch();
+}
+
+int spin_lock_claim_unused(bool required) {
+    for (uint i = 16; i < 32; i++) {
+        if (!hal.spin_lock_claimed[i]) {
+            hal.spin_lock_claimed[i] = true;
+            return (int)i;
+        }
+    }
+    if (required)
+        panic("no spin lock left\n");
+    return -1;
+}
+
+spin_lock_t *spin_lock_init(uint lock_num) {
+    static spin_lock_t locks[32];
+    return &locks[lock_num];
+}
+
+uint32_t spin_lock_blocking(spin_lock_t *lock) {
+    (void)lock;
+    return save_and_disable_interrupts();
+}
+
+void spin_unlock(spin_lock_t *lock, uint32_t saved_irq) {
+    (void)lock;
+    restore_interrupts(saved_irq);
+}
+
+//--------------------------------------------------------------------+
+// Time
+//--------------------------------------------------------------------+
+static void hal_dma_tx_step(uint ch);
+
+void hal_advance(uint32_t us) {
+    static bool advancing;
+
+    while (us--) {
+        hal.now_us++;
+        for (uint ch = 0; ch < HAL_DMA_CHANNELS; ch++)
+            hal_dma_tx_step(ch);
+        if (hal.on_advance && !advancing) {
+            advancing = true;
+            hal.on_advance();
+            advancing = false;
+        }
+        hal_irq_dispatch();
+    }
+}
+
+uint32_t time_us_32(void) {
+    return (uint32_t)hal.now_us;
+}
+
+uint64_t time_us_64(void) {
+    return hal.now_us;
+}
+
+void sleep_us(uint64_t us) {
+    hal_advance((uint32_t)us);
+}
+
+void sleep_ms(uint32_t ms) {
+    hal_advance(ms * 1000);
+}
+
+void tight_loop_contents(void) {
+    hal_advance(1);
+}
+
+bool set_sys_clock_khz(uint32_t freq_khz, bool required) {
+    (void)required;
+    hal.sys_hz = freq_khz * 1000;
+    return true;
+}
+
+uint32_t clock_get_hz(enum clock_index clk) {
+    return clk == clk_sys ? hal.sys_hz : 48000000;
+}
+
+void multicore_launch_core1(void (*entry)(void)) {
+    hal.core1_entry = entry;
+}
+
+void board_init(void) {
+}
+
+void board_led_write(bool state) {
+    (void)state;
+}
+
+uint32_t board_millis(void) {
+    return (uint32_t)(hal.now_us / 1000);
+}
+
+//--------------------------------------------------------------------+
+// GPIO
+//--------------------------------------------------------------------+
+void gpio_init(uint gpio) {
+    hal.gpio_dir[gpio] = false;
+    hal.gpio_out[gpio] = false;
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+    hal.gpio_dir[gpio] = out;
+}
+
+void gpio_put(uint gpio, bool value) {
+    hal.gpio_out[gpio] = value;
+}
+
+bool gpio_get(uint gpio) {
+    return hal.gpio_out[gpio];
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn) {
+    (void)gpio;
+    (void)fn;
+}
+
+void gpio_pull_up(uint gpio) {
+    (void)gpio;
+}
+
+void gpio_add_raw_irq_handler(uint gpio, irq_handler_t handler) {
+    hal.gpio_raw_handler[gpio] = handler;
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled) {
+    if (enabled)
+        hal.gpio_irq_enabled[gpio] |= events;
+    else
+        hal.gpio_irq_enabled[gpio] &= ~events;
+}
+
+uint32_t gpio_get_irq_event_mask(uint gpio) {
+    return hal.gpio_irq_events[gpio];
+}
+
+void gpio_acknowledge_irq(uint gpio, uint32_t events) {
+    hal.gpio_irq_events[gpio] &= ~events;
+}
+
+// IO_IRQ_BANK0 runs every raw handler with an event pending, as the SDK's shared
+// handler does.
+static void hal_gpio_irq(void) {
+    for (uint gpio = 0; gpio < HAL_GPIO_COUNT; gpio++) {
+        if (hal.gpio_irq_events[gpio] && hal.gpio_raw_handler[gpio])
+            hal.gpio_raw_handler[gpio]();
+    }
+}
+
+void hal_gpio_edge(uint gpio, uint32_t events) {
+    events &= hal.gpio_irq_enabled[gpio];
+    if (!events)
+        return;
+    hal.gpio_irq_events[gpio] |= events;
+    hal.irq_handler[IO_IRQ_BANK0] = hal_gpio_irq;
+    hal_irq_raise(IO_IRQ_BANK0);
+}
+
+//--------------------------------------------------------------------+
+// I2C
+//--------------------------------------------------------------------+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate) {
+    i2c->baudrate = baudrate;
+    return baudrate;
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop) {
+    (void)i2c;
+    (void)nostop;
+    return hal.i2c_write ? hal.i2c_write(addr, src, len) : (int)len;
+}
+
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop) {
+    (void)i2c;
+    (void)nostop;
+    if (hal.i2c_read)
+        return hal.i2c_read(addr, dst, len);
+    memset(dst, 0, len);
+    return (int)len;
+}
+
+//--------------------------------------------------------------------+
+// DMA
+//--------------------------------------------------------------------+
+void dma_channel_claim(uint channel) {
+    if (hal.dma[channel].claimed)
+        panic("DMA channel %u already claimed\n", channel);
+    hal.dma[channel].claimed = true;
+}
+
+int dma_claim_unused_channel(bool required) {
+    for (uint ch = 0; ch < HAL_DMA_CHANNELS; ch++) {
+        if (!hal.dma[ch].claimed) {
+            hal.dma[ch].claimed = true;
+            return (int)ch;
+        }
+    }
+    if (required)
+        panic("no DMA channel left\n");
+    return -1;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+    (void)channel;
+    return (dma_channel_config){.size = DMA_SIZE_32, .read_increment = true, .dreq = 0x3f};
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) {
+    c->size = size;
+}
+
+void channel_config_set_read_increment(dma_channel_config *c, bool incr) {
+    c->read_increment = incr;
+}
+
+void channel_config_set_write_increment(dma_channel_config *c, bool incr) {
+    c->write_increment = incr;
+}
+
+void channel_config_set_dreq(dma_channel_config *c, uint dreq) {
+    c->dreq = dreq;
+}
+
+void channel_config_set_ring(dma_channel_config *c, bool write, uint size_bits) {
+    c->ring_write = write;
+    c->ring_bits = size_bits;
+}
+
+static void hal_dma_trigger(uint ch, bool trigger) {
+    if (trigger)
+        hal.dma[ch].busy = hal.dma[ch].hw.transfer_count != 0;
+}
+
+void dma_channel_set_config(uint channel, const dma_channel_config *c, bool trigger) {
+    hal.dma[channel].config = *c;
+    hal_dma_trigger(channel, trigger);
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *c, volatile void *write_addr,
+                           const volatile void *read_addr, uint transfer_count, bool trigger) {
+    hal.dma[channel].config = *c;
+    hal.dma[channel].write_addr = (uintptr_t)write_addr;
+    hal.dma[channel].read_addr = (uintptr_t)read_addr;
+    hal.dma[channel].hw.transfer_count = transfer_count;
+    hal_dma_trigger(channel, trigger);
+}
+
+void dma_channel_set_write_addr(uint channel, volatile void *write_addr, bool trigger) {
+    hal.dma[channel].write_addr = (uintptr_t)write_addr;
+    hal_dma_trigger(channel, trigger);
+}
+
+void dma_channel_set_read_addr(uint channel, const volatile void *read_addr, bool trigger) {
+    hal.dma[channel].read_addr = (uintptr_t)read_addr;
+    hal_dma_trigger(channel, trigger);
+}
+
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger) {
+    hal.dma[channel].hw.transfer_count = trans_count;
+    hal_dma_trigger(channel, trigger);
+}
+
+void dma_channel_transfer_from_buffer_now(uint channel, const volatile void *read_addr, uint32_t transfer_count) {
+    hal.dma[channel].read_addr = (uintptr_t)read_addr;
+    hal.dma[channel].hw.transfer_count = transfer_count;
+    hal_dma_trigger(channel, true);
+}
+
+void dma_channel_start(uint channel) {
+    hal_dma_trigger(channel, true);
+}
+
+void dma_channel_abort(uint channel) {
+    hal.dma[channel].busy = false;
+}
+
+bool dma_channel_is_busy(uint channel) {
+    return hal.dma[channel].busy;
+}
+
+dma_channel_hw_t *dma_channel_hw_addr(uint channel) {
+    return &hal.dma[channel].hw;
+}
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled) {
+    hal.dma[channel].irq0 = enabled;
+}
+
+void dma_channel_set_irq1_enabled(uint channel, bool enabled) {
+    hal.dma[channel].irq1 = enabled;
+}
+
+static void hal_dma_complete(uint ch) {
+    struct hal_dma *d = &hal.dma[ch];
+
+    d->busy = false;
+    if (d->irq0) {
+        dma_hw->ints0 |= 1u << ch;
+        hal_irq_raise(DMA_IRQ_0);
+    }
+    if (d->irq1) {
+        dma_hw->ints1 |= 1u << ch;
+        hal_irq_raise(DMA_IRQ_1);
+    }
+}
+
+// One transfer of a busy channel, addresses stepped and wrapped as configured.
+static void hal_dma_move(uint ch) {
+    struct hal_dma *d = &hal.dma[ch];
+    uint bytes = 1u << d->config.size;
+    uintptr_t ring_mask = d->config.ring_bits ? ((uintptr_t)1 << d->config.ring_bits) - 1 : 0;
+
+    if (d->config.read_increment) {
+        uintptr_t next = d->read_addr + bytes;
+        if (ring_mask && !d->config.ring_write)
+            next = (d->read_addr & ~ring_mask) | (next & ring_mask);
+        d->read_addr = next;
+    }
+    if (d->config.write_increment) {
+        uintptr_t next = d->write_addr + bytes;
+        if (ring_mask && d->config.ring_write)
+            next = (d->write_addr & ~ring_mask) | (next & ring_mask);
+        d->write_addr = next;
+    }
+    if (--d->hw.transfer_count == 0)
+        hal_dma_complete(ch);
+}
+
+static bool hal_dma_paced_by_tx(uint ch) {
+    uint dreq = hal.dma[ch].config.dreq;
+    return dreq < 16 && !(dreq & 4);
+}
+
+static void hal_dma_tx_step(uint ch) {
+    struct hal_dma *d = &hal.dma[ch];
+    uint bytes = 1u << d->config.size;
+
+    if (!d->busy || !hal_dma_paced_by_tx(ch)) {
+        d->credit = 0;
+        return;
+    }
+    d->credit += hal.tx_bytes_per_us;
+    while (d->busy && d->credit >= bytes) {
+        if (hal.on_dma_tx)
+            hal.on_dma_tx(ch, (const void *)d->read_addr, bytes);
+        d->credit -= bytes;
+        hal_dma_move(ch);
+    }
+}
+
+size_t hal_dma_write(uint channel, const void *data, size_t len) {
+    struct hal_dma *d = &hal.dma[channel];
+    uint bytes = 1u << d->config.size;
+    size_t done = 0;
+
+    while (d->busy && len - done >= bytes) {
+        memcpy((void *)d->write_addr, (const uint8_t *)data + done, bytes);
+        done += bytes;
+        hal_dma_move(channel);
+    }
+    return done;
+}
+
+//--------------------------------------------------------------------+
+// PIO
+//--------------------------------------------------------------------+
+uint pio_get_index(PIO pio) {
+    return (uint)(pio - hal_pio_hw);
+}
+
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx) {
+    return is_tx ? DREQ_PIO_TX(pio_get_index(pio), sm) : DREQ_PIO_RX(pio_get_index(pio), sm);
+}
+
+// JMP targets are relocated by the load offset, as pio_add_program() does.
+uint pio_add_program(PIO pio, const pio_program_t *program) {
+    uint idx = pio_get_index(pio);
+    uint offset = hal.pio_program_end[idx];
+
+    if (offset + program->length > 32)
+        panic("PIO instruction memory full\n");
+    for (uint i = 0; i < program->length; i++) {
+        uint16_t instr = program->instructions[i];
+        pio->instr_mem[offset + i] = (instr & 0xe000) == 0 ? instr + offset : instr;
+    }
+    hal.pio_program_end[idx] = offset + program->length;
+    return offset;
+}
+
+void pio_gpio_init(PIO pio, uint pin) {
+    (void)pio;
+    (void)pin;
+}
+
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out) {
+    (void)pio;
+    (void)sm;
+    for (uint i = 0; i < pin_count; i++)
+        hal.gpio_dir[(pin_base + i) % HAL_GPIO_COUNT] = is_out;
+}
+
+pio_sm_config pio_get_default_sm_config(void) {
+    pio_sm_config c = {0};
+    c.clkdiv = 1u << 16;
+    sm_config_set_wrap(&c, 0, 31);
+    sm_config_set_in_shift(&c, true, false, 32);
+    sm_config_set_out_shift(&c, true, false, 32);
+    return c;
+}
+
+void sm_config_set_wrap(pio_sm_config *c, uint wrap_target, uint wrap) {
+    c->execctrl = (c->execctrl & ~(0x3ffu << PIO_SM0_EXECCTRL_WRAP_BOTTOM_LSB)) |
+                  wrap_target << PIO_SM0_EXECCTRL_WRAP_BOTTOM_LSB | wrap << PIO_SM0_EXECCTRL_WRAP_TOP_LSB;
+}
+
+void sm_config_set_sideset(pio_sm_config *c, uint bit_count, bool optional, bool pindirs) {
+    (void)pindirs;
+    c->pinctrl = (c->pinctrl & ~(7u << PIO_SM0_PINCTRL_SIDESET_COUNT_LSB)) |
+                 bit_count << PIO_SM0_PINCTRL_SIDESET_COUNT_LSB;
+    if (optional)
+        c->execctrl |= PIO_SM0_EXECCTRL_SIDE_EN_BITS;
+    else
+        c->execctrl &= ~PIO_SM0_EXECCTRL_SIDE_EN_BITS;
+}
+
+void sm_config_set_sideset_pins(pio_sm_config *c, uint sideset_base) {
+    c->pinctrl = (c->pinctrl & ~(0x1fu << PIO_SM0_PINCTRL_SIDESET_BASE_LSB)) |
+                 sideset_base << PIO_SM0_PINCTRL_SIDESET_BASE_LSB;
+}
+
+void sm_config_set_out_pins(pio_sm_config *c, uint out_base, uint out_count) {
+    c->pinctrl = (c->pinctrl & ~(0x1fu << PIO_SM0_PINCTRL_OUT_BASE_LSB | 0x3fu << PIO_SM0_PINCTRL_OUT_COUNT_LSB)) |
+                 out_base << PIO_SM0_PINCTRL_OUT_BASE_LSB | out_count << PIO_SM0_PINCTRL_OUT_COUNT_LSB;
+}
+
+void sm_config_set_in_pins(pio_sm_config *c, uint in_base) {
+    c->pinctrl = (c->pinctrl & ~(0x1fu << PIO_SM0_PINCTRL_IN_BASE_LSB)) | in_base << PIO_SM0_PINCTRL_IN_BASE_LSB;
+}
+
+void sm_config_set_jmp_pin(pio_sm_config *c, uint pin) {
+    c->execctrl = (c->execctrl & ~(0x1fu << PIO_SM0_EXECCTRL_JMP_PIN_LSB)) | pin << PIO_SM0_EXECCTRL_JMP_PIN_LSB;
+}
+
+void sm_config_set_in_shift(pio_sm_config *c, bool shift_right, bool autopush, uint push_threshold) {
+    c->shiftctrl = (c->shiftctrl & ~(PIO_SM0_SHIFTCTRL_IN_SHIFTDIR_BITS | PIO_SM0_SHIFTCTRL_AUTOPUSH_BITS |
+                                     PIO_SM0_SHIFTCTRL_PUSH_THRESH_BITS)) |
+                   (shift_right ? PIO_SM0_SHIFTCTRL_IN_SHIFTDIR_BITS : 0) |
+                   (autopush ? PIO_SM0_SHIFTCTRL_AUTOPUSH_BITS : 0) |
+                   (push_threshold & 0x1fu) << PIO_SM0_SHIFTCTRL_PUSH_THRESH_LSB;
+}
+
+void sm_config_set_out_shift(pio_sm_config *c, bool shift_right, bool autopull, uint pull_threshold) {
+    c->shiftctrl = (c->shiftctrl & ~(PIO_SM0_SHIFTCTRL_OUT_SHIFTDIR_BITS | PIO_SM0_SHIFTCTRL_AUTOPULL_BITS |
+                                     PIO_SM0_SHIFTCTRL_PULL_THRESH_BITS)) |
+                   (shift_right ? PIO_SM0_SHIFTCTRL_OUT_SHIFTDIR_BITS : 0) |
+                   (autopull ? PIO_SM0_SHIFTCTRL_AUTOPULL_BITS : 0) |
+                   (pull_threshold & 0x1fu) << PIO_SM0_SHIFTCTRL_PULL_THRESH_LSB;
+}
+
+void sm_config_set_fifo_join(pio_sm_config *c, enum pio_fifo_join join) {
+    c->shiftctrl = (c->shiftctrl & ~(PIO_SM0_SHIFTCTRL_FJOIN_TX_BITS | PIO_SM0_SHIFTCTRL_FJOIN_RX_BITS)) |
+                   (join == PIO_FIFO_JOIN_TX ? PIO_SM0_SHIFTCTRL_FJOIN_TX_BITS : 0) |
+                   (join == PIO_FIFO_JOIN_RX ? PIO_SM0_SHIFTCTRL_FJOIN_RX_BITS : 0);
+}
+
+void pio_sm_set_config(PIO pio, uint sm, const pio_sm_config *c) {
+    pio->sm[sm].clkdiv = c->clkdiv;
+    pio->sm[sm].execctrl = c->execctrl;
+    pio->sm[sm].shiftctrl = c->shiftctrl;
+    pio->sm[sm].pinctrl = c->pinctrl;
+}
+
+// Disables the state machine, as the SDK's does.
+int pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *c) {
+    struct hal_sm *s = &hal.sm[pio_get_index(pio)][sm];
+
+    pio_sm_set_enabled(pio, sm, false);
+    pio_sm_set_config(pio, sm, c);
+    pio_sm_clear_fifos(pio, sm);
+    pio_sm_restart(pio, sm);
+    pio->sm[sm].addr = initial_pc;
+    s->inits++;
+    if (hal.on_sm_init)
+        hal.on_sm_init(pio, sm);
+    return 0;
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) {
+    hal.sm[pio_get_index(pio)][sm].enabled = enabled;
+    if (enabled)
+        pio->ctrl |= 1u << sm;
+    else
+        pio->ctrl &= ~(1u << sm);
+    if (hal.on_sm_enabled)
+        hal.on_sm_enabled(pio, sm, enabled);
+}
+
+void pio_sm_restart(PIO pio, uint sm) {
+    hal.sm[pio_get_index(pio)][sm].restarts++;
+}
+
+void pio_sm_clear_fifos(PIO pio, uint sm) {
+    (void)pio;
+    (void)sm;
+}
+
+void pio_sm_exec(PIO pio, uint sm, uint instr) {
+    hal.sm[pio_get_index(pio)][sm].execs++;
+    pio->sm[sm].instr = instr;
+    if ((instr & 0xe000) == 0)
+        pio->sm[sm].addr = instr & 0x1f;
+    if (hal.on_exec)
+        hal.on_exec(pio, sm, instr);
+}
+
+void pio_sm_put(PIO pio, uint sm, uint32_t data) {
+    pio->txf[sm] = data;
+    hal.sm[pio_get_index(pio)][sm].last_put = data;
+}
+
+// The model state machines drain their FIFOs at once: a word the program pushes
+// is taken by the DMA as it is written (hal_dma_write()), and TX words vanish.
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm) {
+    (void)pio;
+    (void)sm;
+    return true;
+}
+
+bool pio_sm_is_tx_fifo_full(PIO pio, uint sm) {
+    (void)pio;
+    (void)sm;
+    return false;
+}
+
+void pio_set_irq0_source_enabled(PIO pio, enum pio_interrupt_source source, bool enabled) {
+    hal.sm[pio_get_index(pio)][source - pis_interrupt0].irq0_source = enabled;
+}
+
+bool pio_interrupt_get(PIO pio, uint pio_interrupt_num) {
+    return pio->irq & (1u << pio_interrupt_num);
+}
+
+void pio_interrupt_clear(PIO pio, uint pio_interrupt_num) {
+    pio->irq &= ~(1u << pio_interrupt_num);
+}
+
+void hal_pio_irq(PIO pio, uint sm) {
+    uint idx = pio_get_index(pio);
+
+    pio->irq |= 1u << sm;
+    if (hal.sm[idx][sm].irq0_source)
+        hal_irq_raise(idx ? PIO1_IRQ_0 : PIO0_IRQ_0);
+}
@@ -0,0 +1,331 @@
+/**
+ * Host model of the pico-sdk calls ov2640.c, ili9341_lcd.c and main.c make, behind
+ * the hardware/ and pico/ headers next to this one. The state is in hal_model.c.
+ *
+ * Time only moves when the firmware waits (tight_loop_contents(), sleep_us(),
+ * sleep_ms()) or the test calls hal_advance(). A DMA channel paced by a PIO TX
+ * DREQ drains at hal.tx_bytes_per_us as time moves; one paced by a PIO RX DREQ
+ * is written by the test with hal_dma_write(), standing in for the sensor.
+ * Interrupt handlers run from hal_advance(), hal_dma_write() and hal_irq_raise(),
+ * so between firmware statements that wait, never in the middle of one.
+ *
+ * Spin locks and critical sections do nothing: one thread runs everything.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef HAL_MODEL_H
+#define HAL_MODEL_H
+
+#include <sched.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef unsigned int uint;
+
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+#ifndef MIN
+#define MIN(a, b) ((b) > (a) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+#define __not_in_flash_func(f) f
+#define __time_critical_func(f) f
+
+// pico/time.h, pico/stdlib.h
+uint32_t time_us_32(void);
+uint64_t time_us_64(void);
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+void tight_loop_contents(void);
+bool set_sys_clock_khz(uint32_t freq_khz, bool required);
+#define panic(...) (fprintf(stderr, __VA_ARGS__), abort())
+
+// hardware/clocks.h
+enum clock_index { clk_gpout0, clk_gpout1, clk_gpout2, clk_gpout3, clk_ref, clk_sys, clk_peri, clk_usb, clk_adc };
+uint32_t clock_get_hz(enum clock_index clk);
+
+// hardware/sync.h
+typedef volatile uint32_t spin_lock_t;
+static inline void __dmb(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+static inline void __compiler_memory_barrier(void) {
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
+static inline void __sev(void) {
+}
+// The other core may be another thread: let it run.
+static inline void __wfe(void) {
+    sched_yield();
+}
+int spin_lock_claim_unused(bool required);
+spin_lock_t *spin_lock_init(uint lock_num);
+uint32_t spin_lock_blocking(spin_lock_t *lock);
+void spin_unlock(spin_lock_t *lock, uint32_t saved_irq);
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+
+// hardware/irq.h
+typedef void (*irq_handler_t)(void);
+enum irq_num { PIO0_IRQ_0 = 7, PIO0_IRQ_1, PIO1_IRQ_0, PIO1_IRQ_1, DMA_IRQ_0, DMA_IRQ_1, IO_IRQ_BANK0, HAL_IRQ_COUNT = 32 };
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+void irq_set_enabled(uint num, bool enabled);
+
+// hardware/gpio.h
+enum gpio_function { GPIO_FUNC_SPI = 1, GPIO_FUNC_UART, GPIO_FUNC_I2C, GPIO_FUNC_PWM, GPIO_FUNC_SIO, GPIO_FUNC_PIO0, GPIO_FUNC_PIO1 };
+enum gpio_irq_level { GPIO_IRQ_LEVEL_LOW = 1, GPIO_IRQ_LEVEL_HIGH = 2, GPIO_IRQ_EDGE_FALL = 4, GPIO_IRQ_EDGE_RISE = 8 };
+#define GPIO_OUT 1
+#define GPIO_IN 0
+#define HAL_GPIO_COUNT 30
+#define PICO_DEFAULT_I2C_SDA_PIN 4
+#define PICO_DEFAULT_I2C_SCL_PIN 5
+void gpio_init(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_put(uint gpio, bool value);
+bool gpio_get(uint gpio);
+void gpio_set_function(uint gpio, enum gpio_function fn);
+void gpio_pull_up(uint gpio);
+void gpio_add_raw_irq_handler(uint gpio, irq_handler_t handler);
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled);
+uint32_t gpio_get_irq_event_mask(uint gpio);
+void gpio_acknowledge_irq(uint gpio, uint32_t events);
+
+// hardware/i2c.h
+typedef struct i2c_inst {
+    uint baudrate;
+} i2c_inst_t;
+extern i2c_inst_t hal_i2c[2];
+#define i2c0 (&hal_i2c[0])
+#define i2c1 (&hal_i2c[1])
+#define i2c_default i2c0
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop);
+
+// hardware/dma.h
+#define HAL_DMA_CHANNELS 12
+enum dma_channel_transfer_size { DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2 };
+typedef struct {
+    enum dma_channel_transfer_size size;
+    bool read_increment, write_increment;
+    uint dreq;
+    bool ring_write; // the ring wraps the write address, else the read address
+    uint ring_bits;  // 0: no ring
+} dma_channel_config;
+typedef struct {
+    volatile uint32_t transfer_count;
+} dma_channel_hw_t;
+typedef struct {
+    volatile uint32_t ints0, ints1;
+} dma_hw_t;
+extern dma_hw_t *const dma_hw;
+void dma_channel_claim(uint channel);
+int dma_claim_unused_channel(bool required);
+dma_channel_config dma_channel_get_default_config(uint channel);
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size);
+void channel_config_set_read_increment(dma_channel_config *c, bool incr);
+void channel_config_set_write_increment(dma_channel_config *c, bool incr);
+void channel_config_set_dreq(dma_channel_config *c, uint dreq);
+void channel_config_set_ring(dma_channel_config *c, bool write, uint size_bits);
+void dma_channel_set_config(uint channel, const dma_channel_config *c, bool trigger);
+void dma_channel_configure(uint channel, const dma_channel_config *c, volatile void *write_addr,
+                           const volatile void *read_addr, uint transfer_count, bool trigger);
+void dma_channel_set_write_addr(uint channel, volatile void *write_addr, bool trigger);
+void dma_channel_set_read_addr(uint channel, const volatile void *read_addr, bool trigger);
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger);
+void dma_channel_transfer_from_buffer_now(uint channel, const volatile void *read_addr, uint32_t transfer_count);
+void dma_channel_start(uint channel);
+void dma_channel_abort(uint channel);
+bool dma_channel_is_busy(uint channel);
+dma_channel_hw_t *dma_channel_hw_addr(uint channel);
+void dma_channel_set_irq0_enabled(uint channel, bool enabled);
+void dma_channel_set_irq1_enabled(uint channel, bool enabled);
+
+// hardware/pio.h, with the register bits the firmware touches laid out as on the chip.
+#define HAL_PIO_SM 4
+typedef struct {
+    volatile uint32_t clkdiv, execctrl, shiftctrl, addr, instr, pinctrl;
+} pio_sm_hw_t;
+typedef struct {
+    volatile uint32_t ctrl, fstat, fdebug, flevel;
+    volatile uint32_t txf[HAL_PIO_SM];
+    volatile uint32_t rxf[HAL_PIO_SM];
+    volatile uint32_t irq;
+    volatile uint32_t instr_mem[32];
+    pio_sm_hw_t sm[HAL_PIO_SM];
+} pio_hw_t;
+typedef pio_hw_t *PIO;
+extern pio_hw_t hal_pio_hw[2];
+#define pio0 (&hal_pio_hw[0])
+#define pio1 (&hal_pio_hw[1])
+
+#define PIO_FDEBUG_TXSTALL_LSB 24
+#define PIO_SM0_SHIFTCTRL_FJOIN_RX_BITS (1u << 31)
+#define PIO_SM0_SHIFTCTRL_FJOIN_TX_BITS (1u << 30)
+#define PIO_SM0_SHIFTCTRL_PULL_THRESH_LSB 25
+#define PIO_SM0_SHIFTCTRL_PULL_THRESH_BITS (0x1fu << 25)
+#define PIO_SM0_SHIFTCTRL_PUSH_THRESH_LSB 20
+#define PIO_SM0_SHIFTCTRL_PUSH_THRESH_BITS (0x1fu << 20)
+#define PIO_SM0_SHIFTCTRL_OUT_SHIFTDIR_BITS (1u << 19)
+#define PIO_SM0_SHIFTCTRL_IN_SHIFTDIR_BITS (1u << 18)
+#define PIO_SM0_SHIFTCTRL_AUTOPULL_BITS (1u << 17)
+#define PIO_SM0_SHIFTCTRL_AUTOPUSH_BITS (1u << 16)
+#define PIO_SM0_EXECCTRL_SIDE_EN_BITS (1u << 30)
+#define PIO_SM0_EXECCTRL_JMP_PIN_LSB 24
+#define PIO_SM0_EXECCTRL_WRAP_TOP_LSB 12
+#define PIO_SM0_EXECCTRL_WRAP_BOTTOM_LSB 7
+#define PIO_SM0_PINCTRL_SIDESET_COUNT_LSB 29
+#define PIO_SM0_PINCTRL_OUT_COUNT_LSB 20
+#define PIO_SM0_PINCTRL_IN_BASE_LSB 15
+#define PIO_SM0_PINCTRL_SIDESET_BASE_LSB 10
+#define PIO_SM0_PINCTRL_OUT_BASE_LSB 0
+
+typedef struct {
+    uint32_t clkdiv, execctrl, shiftctrl, pinctrl;
+} pio_sm_config;
+typedef struct pio_program {
+    const uint16_t *instructions;
+    uint8_t length;
+    int8_t origin;
+} pio_program_t;
+enum pio_fifo_join { PIO_FIFO_JOIN_NONE, PIO_FIFO_JOIN_TX, PIO_FIFO_JOIN_RX };
+enum pio_interrupt_source { pis_interrupt0 = 8, pis_interrupt1, pis_interrupt2, pis_interrupt3 };
+enum pio_src_dest { pio_pins, pio_x, pio_y, pio_null, pio_pindirs, pio_exec_mov = 4, pio_status, pio_pc = 5,
+                    pio_isr, pio_osr, pio_exec_out = 7 };
+
+static inline void hw_write_masked(volatile uint32_t *addr, uint32_t values, uint32_t mask) {
+    *addr = (*addr & ~mask) | (values & mask);
+}
+static inline void hw_set_bits(volatile uint32_t *addr, uint32_t mask) {
+    *addr |= mask;
+}
+static inline void hw_clear_bits(volatile uint32_t *addr, uint32_t mask) {
+    *addr &= ~mask;
+}
+
+uint pio_get_index(PIO pio);
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx);
+uint pio_add_program(PIO pio, const pio_program_t *program);
+void pio_gpio_init(PIO pio, uint pin);
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out);
+pio_sm_config pio_get_default_sm_config(void);
+void sm_config_set_wrap(pio_sm_config *c, uint wrap_target, uint wrap);
+void sm_config_set_sideset(pio_sm_config *c, uint bit_count, bool optional, bool pindirs);
+void sm_config_set_sideset_pins(pio_sm_config *c, uint sideset_base);
+void sm_config_set_out_pins(pio_sm_config *c, uint out_base, uint out_count);
+void sm_config_set_in_pins(pio_sm_config *c, uint in_base);
+void sm_config_set_jmp_pin(pio_sm_config *c, uint pin);
+void sm_config_set_in_shift(pio_sm_config *c, bool shift_right, bool autopush, uint push_threshold);
+void sm_config_set_out_shift(pio_sm_config *c, bool shift_right, bool autopull, uint pull_threshold);
+void sm_config_set_fifo_join(pio_sm_config *c, enum pio_fifo_join join);
+void pio_sm_set_config(PIO pio, uint sm, const pio_sm_config *c);
+int pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *c);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_sm_restart(PIO pio, uint sm);
+void pio_sm_clear_fifos(PIO pio, uint sm);
+void pio_sm_exec(PIO pio, uint sm, uint instr);
+void pio_sm_put(PIO pio, uint sm, uint32_t data);
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm);
+bool pio_sm_is_tx_fifo_full(PIO pio, uint sm);
+void pio_set_irq0_source_enabled(PIO pio, enum pio_interrupt_source source, bool enabled);
+bool pio_interrupt_get(PIO pio, uint pio_interrupt_num);
+void pio_interrupt_clear(PIO pio, uint pio_interrupt_num);
+
+// hardware/pio_instructions.h, encoded as on the chip.
+static inline uint pio_encode_jmp(uint addr) {
+    return 0x0000 | addr;
+}
+static inline uint pio_encode_wait_gpio(bool polarity, uint gpio) {
+    return 0x2000 | (uint)polarity << 7 | gpio;
+}
+static inline uint pio_encode_in(enum pio_src_dest src, uint count) {
+    return 0x4000 | (uint)src << 5 | (count & 31);
+}
+static inline uint pio_encode_out(enum pio_src_dest dest, uint count) {
+    return 0x6000 | (uint)dest << 5 | (count & 31);
+}
+static inline uint pio_encode_pull(bool if_empty, bool block) {
+    return 0x8080 | (uint)if_empty << 6 | (uint)block << 5;
+}
+static inline uint pio_encode_mov(enum pio_src_dest dest, enum pio_src_dest src) {
+    return 0xa000 | (uint)dest << 5 | src;
+}
+static inline uint pio_encode_nop(void) {
+    return pio_encode_mov(pio_y, pio_y);
+}
+
+// pico/multicore.h
+void multicore_launch_core1(void (*entry)(void));
+
+// What the model keeps per state machine, DMA channel and interrupt.
+struct hal_sm {
+    bool enabled;
+    bool irq0_source; // pis_interrupt0 + sm routed to PIOx_IRQ_0
+    uint inits, restarts, execs;
+    uint32_t last_put; // last word pio_sm_put() queued
+};
+
+struct hal_dma {
+    dma_channel_config config;
+    dma_channel_hw_t hw;
+    uintptr_t read_addr, write_addr;
+    bool claimed, busy, irq0, irq1;
+    double credit; // bytes a TX paced channel may still move this us
+};
+
+struct hal_model {
+    uint64_t now_us;
+    double tx_bytes_per_us;  // drain rate of channels paced by a PIO TX DREQ
+    uint32_t sys_hz;
+
+    irq_handler_t irq_handler[HAL_IRQ_COUNT];
+    uint32_t irq_enabled, irq_pending;
+    uint irq_masked; // save_and_disable_interrupts() depth
+    bool in_irq;
+
+    bool gpio_out[HAL_GPIO_COUNT];
+    bool gpio_dir[HAL_GPIO_COUNT];
+    uint32_t gpio_irq_enabled[HAL_GPIO_COUNT];
+    uint32_t gpio_irq_events[HAL_GPIO_COUNT];
+    irq_handler_t gpio_raw_handler[HAL_GPIO_COUNT];
+
+    struct hal_dma dma[HAL_DMA_CHANNELS];
+    struct hal_sm sm[2][HAL_PIO_SM];
+    uint pio_program_end[2];
+    bool spin_lock_claimed[32];
+    void (*core1_entry)(void); // multicore_launch_core1(), not run
+
+    // Optional test hooks.
+    void (*on_advance)(void);                                        // once per us moved
+    void (*on_exec)(PIO pio, uint sm, uint instr);                   // pio_sm_exec()
+    void (*on_sm_init)(PIO pio, uint sm);                            // pio_sm_init()
+    void (*on_sm_enabled)(PIO pio, uint sm, bool enabled);           // pio_sm_set_enabled()
+    void (*on_dma_tx)(uint channel, const void *data, size_t bytes); // bytes a TX channel moved
+    int (*i2c_write)(uint8_t addr, const uint8_t *src, size_t len);
+    int (*i2c_read)(uint8_t addr, uint8_t *dst, size_t len);
+};
+
+extern struct hal_model hal;
+
+// Back to power on, hooks cleared.
+void hal_reset(void);
+// Move time on by us, draining TX paced DMA channels and raising their interrupts.
+void hal_advance(uint32_t us);
+// Mark irq pending and run its handler, unless interrupts are masked or a handler
+// is already running, in which case it runs once they are not.
+void hal_irq_raise(uint irq);
+// The sensor side of an RX paced channel: write up to len bytes at its write
+// address, as whole transfers, wrapping in its ring. Returns the bytes taken,
+// fewer once the transfer count runs out or if the channel is not busy.
+size_t hal_dma_write(uint channel, const void *data, size_t len);
+// A PIO program raising its relative IRQ 0, and the NVIC line behind it.
+void hal_pio_irq(PIO pio, uint sm);
+// An edge on a GPIO with edge interrupts enabled, through its raw handler.
+void hal_gpio_edge(uint gpio, uint32_t events);
+
+#endif
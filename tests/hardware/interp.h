@@ -0,0 +1,97 @@
+/**
+ * Host model of the RP2040 SIO interpolators, with the pico-sdk hardware/interp.h
+ * calls yuv.c uses. Lanes shift, mask, sign-extend and take a cross input, lane 0
+ * of interp1 clamps; blend, cross result, add raw and force MSB are not modelled.
+ *
+ * Every access through interp0 or interp1 first recomputes the PEEK registers
+ * from ACCUM, BASE and the lane configuration, so reading peek right after writing
+ * accum sees the new result like on the chip. BASE and PEEK are pointer sized, so
+ * table addresses survive on a 64-bit host.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef HOST_HARDWARE_INTERP_H
+#define HOST_HARDWARE_INTERP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    unsigned shift, mask_lsb, mask_msb;
+    bool is_signed, cross_input, clamp;
+} interp_config;
+
+typedef struct {
+    uint32_t accum[2];
+    uintptr_t base[3];
+    uintptr_t peek[3];
+    interp_config ctrl[2];
+    bool has_clamp;
+} interp_hw_t;
+
+extern interp_hw_t host_interp_hw[2];
+
+static inline int32_t host_interp_lane(const interp_hw_t *interp, unsigned lane) {
+    const interp_config *c = &interp->ctrl[lane];
+    uint32_t in = interp->accum[c->cross_input ? !lane : lane];
+    uint32_t mask = (c->mask_msb == 31 ? ~0u : (2u << c->mask_msb) - 1) & ~((1u << c->mask_lsb) - 1);
+    uint32_t v = (in >> c->shift) & mask;
+
+    if (c->is_signed && (v >> c->mask_msb & 1) && c->mask_msb < 31)
+        v |= ~0u << (c->mask_msb + 1);
+    return (int32_t)v;
+}
+
+static inline interp_hw_t *host_interp_sync(interp_hw_t *interp) {
+    int32_t r0 = host_interp_lane(interp, 0), r1 = host_interp_lane(interp, 1);
+
+    if (interp->has_clamp && interp->ctrl[0].clamp) {
+        if (interp->ctrl[0].is_signed)
+            r0 = r0 < (int32_t)interp->base[0] ? (int32_t)interp->base[0]
+                 : r0 > (int32_t)interp->base[1] ? (int32_t)interp->base[1] : r0;
+        else
+            r0 = (uint32_t)r0 < (uint32_t)interp->base[0] ? (int32_t)interp->base[0]
+                 : (uint32_t)r0 > (uint32_t)interp->base[1] ? (int32_t)interp->base[1] : r0;
+        interp->peek[0] = (uintptr_t)(uint32_t)r0;
+    } else {
+        interp->peek[0] = interp->base[0] + (uintptr_t)(intptr_t)r0;
+    }
+    interp->peek[1] = interp->base[1] + (uintptr_t)(intptr_t)r1;
+    interp->peek[2] = interp->base[2] + (uintptr_t)(intptr_t)r0 + (uintptr_t)(intptr_t)r1;
+    return interp;
+}
+
+#define interp0 host_interp_sync(&host_interp_hw[0])
+#define interp1 host_interp_sync(&host_interp_hw[1])
+
+static inline interp_config interp_default_config(void) {
+    interp_config c = {0, 0, 31, false, false, false};
+    return c;
+}
+
+static inline void interp_config_set_shift(interp_config *c, unsigned shift) {
+    c->shift = shift;
+}
+
+static inline void interp_config_set_mask(interp_config *c, unsigned mask_lsb, unsigned mask_msb) {
+    c->mask_lsb = mask_lsb;
+    c->mask_msb = mask_msb;
+}
+
+static inline void interp_config_set_cross_input(interp_config *c, bool cross_input) {
+    c->cross_input = cross_input;
+}
+
+static inline void interp_config_set_signed(interp_config *c, bool is_signed) {
+    c->is_signed = is_signed;
+}
+
+static inline void interp_config_set_clamp(interp_config *c, bool clamp) {
+    c->clamp = clamp;
+}
+
+static inline void interp_set_config(interp_hw_t *interp, unsigned lane, interp_config *config) {
+    interp->ctrl[lane] = *config;
+}
+
+#endif
@@ -0,0 +1,2 @@
+/* hardware/pio_instructions.h of the pico-sdk, from the host model in hal_model.h. */
+#include "hal_model.h"
@@ -0,0 +1,13 @@
+/**
+ * State of the host interpolator model, see hardware/interp.h.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "hardware/interp.h"
+
+// Only interp1 has the clamp mode.
+interp_hw_t host_interp_hw[2] = {
+    {.ctrl = {{0, 0, 31}, {0, 0, 31}}},
+    {.ctrl = {{0, 0, 31}, {0, 0, 31}}, .has_clamp = true},
+};
@@ -0,0 +1,365 @@
+/**
+ * Reference model of one PIO state machine, enough of it to run image.pio and
+ * ili9341_lcd.pio from their source: the instructions they use, IN with right
+ * shift and autopush, OUT with autopull from the TX FIFO, side-set, JMP PIN and
+ * .wrap. One instruction per call to pio_model_step(). Instructions run with
+ * pio_sm_exec() are decoded from their encoding by pio_model_decode().
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef PIO_MODEL_H
+#define PIO_MODEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum pio_op { PIO_NOP, PIO_MOV, PIO_WAIT, PIO_IN, PIO_OUT, PIO_JMP, PIO_IRQ };
+enum pio_reg { PIO_REG_X, PIO_REG_Y, PIO_REG_ISR, PIO_REG_NULL, PIO_REG_PINS };
+enum pio_cond { PIO_JMP_ALWAYS, PIO_JMP_PIN, PIO_JMP_Y_DEC };
+
+struct pio_instr {
+    enum pio_op op;
+    int dst, src;  // MOV registers, IN source, OUT destination
+    int cond;      // JMP condition
+    int polarity;  // WAIT
+    bool gpio;     // WAIT GPIO (absolute) rather than PIN (relative to in_base)
+    int index;     // WAIT pin, IN/OUT bit count, IRQ number, JMP address without a target
+    int side;      // side-set value, -1 for none
+    char target[32];
+};
+
+struct pio_model {
+    struct pio_instr prog[32];
+    char labels[32][32];
+    int length, wrap_target, wrap;
+    int sideset_bits;
+
+    // State machine
+    int pc;
+    uint32_t x, y, isr, osr;
+    int isr_count, osr_count;
+    int in_base, jmp_pin, push_threshold;
+    bool autopull, out_shift_right;
+    int pull_threshold;
+    uint32_t pins; // last OUT to pins
+    int side;      // last side-set value
+    int irqs;
+
+    // RX FIFO as seen by the DMA: words in push order.
+    uint32_t *rx;
+    size_t rx_len, rx_size;
+    // TX FIFO, joined: words in put order.
+    uint32_t tx[8];
+    int tx_len;
+};
+
+static inline int pio_model_label(const struct pio_model *m, const char *name) {
+    for (int i = 0; i < m->length; i++) {
+        if (!strcmp(m->labels[i], name))
+            return i;
+    }
+    fprintf(stderr, "pio_model: no label %s\n", name);
+    exit(2);
+}
+
+static inline int pio_model_reg(const char *s) {
+    if (!strcmp(s, "x"))
+        return PIO_REG_X;
+    if (!strcmp(s, "y"))
+        return PIO_REG_Y;
+    if (!strcmp(s, "isr"))
+        return PIO_REG_ISR;
+    if (!strcmp(s, "null"))
+        return PIO_REG_NULL;
+    if (!strcmp(s, "pins"))
+        return PIO_REG_PINS;
+    fprintf(stderr, "pio_model: unknown register %s\n", s);
+    exit(2);
+}
+
+// Parse the named program out of a .pio file. Labels are kept per instruction,
+// so an instruction index doubles as the program offset.
+static inline void pio_model_load(struct pio_model *m, const char *path, const char *program) {
+    FILE *f = fopen(path, "r");
+    char line[256], pending[32] = "";
+    bool in_program = false;
+
+    if (!f) {
+        perror(path);
+        exit(2);
+    }
+    memset(m, 0, sizeof(*m));
+    m->wrap = -1;
+    while (fgets(line, sizeof(line), f)) {
+        char *p = line, word[5][32];
+        int n;
+
+        for (char *c = line; *c; c++) {
+            if (*c == ';' || (c[0] == '/' && c[1] == '/')) {
+                *c = 0;
+                break;
+            }
+            if (*c == ',')
+                *c = ' ';
+        }
+        while (*p == ' ' || *p == '\t')
+            p++;
+        if (!strncmp(p, ".program", 8)) {
+            char name[32];
+            in_program = sscanf(p + 8, "%31s", name) == 1 && !strcmp(name, program);
+            continue;
+        }
+        if (!in_program)
+            continue;
+        if (*p == '%')
+            break;
+        if (!strncmp(p, ".wrap_target", 12)) {
+            m->wrap_target = m->length;
+            continue;
+        }
+        if (!strncmp(p, ".wrap", 5)) {
+            m->wrap = m->length - 1;
+            continue;
+        }
+        if (!strncmp(p, ".side_set", 9)) {
+            m->sideset_bits = atoi(p + 9);
+            continue;
+        }
+        if (*p == '.')
+            continue; // .define, .origin
+        if (!strncmp(p, "public ", 7))
+            p += 7;
+        n = sscanf(p, "%31s %31s %31s %31s %31s", word[0], word[1], word[2], word[3], word[4]);
+        if (n <= 0)
+            continue;
+        size_t len = strlen(word[0]);
+        if (word[0][len - 1] == ':') {
+            word[0][len - 1] = 0;
+            strcpy(pending, word[0]);
+            continue;
+        }
+
+        struct pio_instr *in = &m->prog[m->length];
+        memset(in, 0, sizeof(*in));
+        in->side = -1;
+        for (int i = 1; i + 1 < n; i++) {
+            if (!strcmp(word[i], "side")) {
+                in->side = atoi(word[i + 1]);
+                n = i;
+            }
+        }
+        strcpy(m->labels[m->length], pending);
+        pending[0] = 0;
+        if (!strcmp(word[0], "nop")) {
+            in->op = PIO_NOP;
+        } else if (!strcmp(word[0], "mov") && n == 3) {
+            in->op = PIO_MOV;
+            in->dst = pio_model_reg(word[1]);
+            in->src = pio_model_reg(word[2]);
+        } else if (!strcmp(word[0], "wait") && n == 4) {
+            in->op = PIO_WAIT;
+            in->polarity = atoi(word[1]);
+            in->gpio = !strcmp(word[2], "gpio");
+            in->index = atoi(word[3]);
+        } else if (!strcmp(word[0], "in") && n == 3) {
+            in->op = PIO_IN;
+            in->src = pio_model_reg(word[1]);
+            in->index = atoi(word[2]);
+        } else if (!strcmp(word[0], "out") && n == 3) {
+            in->op = PIO_OUT;
+            in->dst = pio_model_reg(word[1]);
+            in->index = atoi(word[2]);
+        } else if (!strcmp(word[0], "jmp") && (n == 2 || n == 3)) {
+            in->op = PIO_JMP;
+            in->cond = n == 2 ? PIO_JMP_ALWAYS : !strcmp(word[1], "pin") ? PIO_JMP_PIN : PIO_JMP_Y_DEC;
+            if (n == 3 && in->cond == PIO_JMP_Y_DEC && strcmp(word[1], "y--")) {
+                fprintf(stderr, "pio_model: unsupported jmp %s\n", word[1]);
+                exit(2);
+            }
+            strcpy(in->target, word[n - 1]);
+        } else if (!strcmp(word[0], "irq") && n == 4 && !strcmp(word[1], "nowait") && !strcmp(word[3], "rel")) {
+            in->op = PIO_IRQ;
+            in->index = atoi(word[2]);
+        } else {
+            fprintf(stderr, "pio_model: unsupported instruction %s", p);
+            exit(2);
+        }
+        m->length++;
+    }
+    fclose(f);
+    if (m->wrap < 0)
+        m->wrap = m->length - 1;
+    m->push_threshold = 32;
+    m->pull_threshold = 32;
+    m->osr_count = 32; // empty
+    m->side = -1;
+}
+
+// An instruction from its encoding, as pio_sm_exec() takes it: JMP (always),
+// MOV, IN and OUT between the registers the model has.
+static inline struct pio_instr pio_model_decode(const struct pio_model *m, uint16_t code) {
+    static const int regs[8] = {PIO_REG_PINS, PIO_REG_X, PIO_REG_Y, PIO_REG_NULL, -1, -1, PIO_REG_ISR, -1};
+    struct pio_instr in = {.side = -1};
+    int op = code >> 13, a = (code >> 5) & 7, b = code & 0x1f;
+
+    if (m->sideset_bits)
+        in.side = (code >> (13 - m->sideset_bits)) & ((1 << m->sideset_bits) - 1);
+    if (op == 0 && a == 0) {
+        in.op = PIO_JMP;
+        in.cond = PIO_JMP_ALWAYS;
+        in.index = b;
+    } else if (op == 5 && regs[a] >= 0 && (b >> 3) == 0 && regs[b & 7] >= 0) {
+        in.op = a == 2 && b == 2 ? PIO_NOP : PIO_MOV;
+        in.dst = regs[a];
+        in.src = regs[b & 7];
+    } else if ((op == 2 || op == 3) && regs[a] >= 0) {
+        in.op = op == 2 ? PIO_IN : PIO_OUT;
+        in.src = in.dst = regs[a];
+        in.index = b ? b : 32;
+    } else {
+        fprintf(stderr, "pio_model: cannot decode %04x\n", code);
+        exit(2);
+    }
+    return in;
+}
+
+// A word into the TX FIFO, false if it is full.
+static inline bool pio_model_put(struct pio_model *m, uint32_t word) {
+    if (m->tx_len == 8)
+        return false;
+    m->tx[m->tx_len++] = word;
+    return true;
+}
+
+static inline void pio_model_push(struct pio_model *m) {
+    if (m->rx_len == m->rx_size) {
+        m->rx_size = m->rx_size ? m->rx_size * 2 : 1024;
+        m->rx = realloc(m->rx, m->rx_size * sizeof(*m->rx));
+    }
+    m->rx[m->rx_len++] = m->isr;
+    m->isr = 0;
+    m->isr_count = 0;
+}
+
+static inline void pio_model_free(struct pio_model *m) {
+    free(m->rx);
+    m->rx = NULL;
+    m->rx_len = m->rx_size = 0;
+}
+
+// Run one instruction with the GPIO levels in gpio (bit n = GPIO n). Returns
+// false if it stalls, else sets *next to the instruction that follows it.
+static inline bool pio_model_run(struct pio_model *m, const struct pio_instr *in, uint32_t gpio, int *next) {
+    *next = m->pc == m->wrap ? m->wrap_target : m->pc + 1;
+
+    switch (in->op) {
+    case PIO_NOP:
+        break;
+    case PIO_MOV: {
+        uint32_t v = in->src == PIO_REG_X ? m->x : in->src == PIO_REG_Y ? m->y : in->src == PIO_REG_ISR ? m->isr : 0;
+        if (in->dst == PIO_REG_X)
+            m->x = v;
+        else if (in->dst == PIO_REG_Y)
+            m->y = v;
+        else if (in->dst == PIO_REG_ISR) {
+            m->isr = v;
+            m->isr_count = 0; // MOV to ISR resets the shift counter
+        }
+        break;
+    }
+    case PIO_WAIT: {
+        int pin = in->gpio ? in->index : (m->in_base + in->index) % 32;
+        if ((int)((gpio >> pin) & 1) != in->polarity)
+            return false;
+        break;
+    }
+    case PIO_IN: {
+        uint32_t src = 0;
+        if (in->src == PIO_REG_PINS)
+            src = (gpio >> m->in_base) | (m->in_base ? gpio << (32 - m->in_base) : 0);
+        else if (in->src != PIO_REG_NULL)
+            src = in->src == PIO_REG_X ? m->x : m->y;
+        uint32_t bits = in->index == 32 ? src : src & ((1u << in->index) - 1);
+        // Shift right: new bits enter at the top.
+        m->isr = in->index == 32 ? bits : (m->isr >> in->index) | (bits << (32 - in->index));
+        m->isr_count += in->index;
+        if (m->isr_count >= m->push_threshold)
+            pio_model_push(m);
+        break;
+    }
+    case PIO_OUT: {
+        // Autopull refills an OSR shifted out to the threshold, or stalls.
+        if (m->autopull && m->osr_count >= m->pull_threshold) {
+            if (!m->tx_len)
+                return false;
+            m->osr = m->tx[0];
+            m->osr_count = 0;
+            memmove(m->tx, m->tx + 1, --m->tx_len * sizeof(*m->tx));
+        }
+        int n = in->index;
+        uint32_t bits;
+        if (m->out_shift_right) {
+            bits = n == 32 ? m->osr : m->osr & ((1u << n) - 1);
+            m->osr = n == 32 ? 0 : m->osr >> n;
+        } else {
+            bits = n == 32 ? m->osr : m->osr >> (32 - n);
+            m->osr = n == 32 ? 0 : m->osr << n;
+        }
+        m->osr_count = m->osr_count + n > 32 ? 32 : m->osr_count + n;
+        if (in->dst == PIO_REG_PINS)
+            m->pins = bits;
+        else if (in->dst == PIO_REG_X)
+            m->x = bits;
+        else if (in->dst == PIO_REG_Y)
+            m->y = bits;
+        break;
+    }
+    case PIO_JMP: {
+        bool taken = true;
+        if (in->cond == PIO_JMP_PIN)
+            taken = (gpio >> m->jmp_pin) & 1;
+        else if (in->cond == PIO_JMP_Y_DEC)
+            taken = m->y-- != 0;
+        if (taken)
+            *next = in->target[0] ? pio_model_label(m, in->target) : in->index;
+        break;
+    }
+    case PIO_IRQ:
+        m->irqs++;
+        break;
+    }
+    return true;
+}
+
+// One clock of the state machine: the instruction at pc, which stalls in place.
+// Its side-set takes effect either way. False if it stalled.
+static inline bool pio_model_step(struct pio_model *m, uint32_t gpio) {
+    const struct pio_instr *in = &m->prog[m->pc];
+    int next;
+
+    if (in->side >= 0)
+        m->side = in->side;
+    if (!pio_model_run(m, in, gpio, &next))
+        return false;
+    m->pc = next;
+    return true;
+}
+
+// pio_sm_exec() of an instruction that does not stall, false if it would have.
+// A JMP moves pc.
+static inline bool pio_model_exec(struct pio_model *m, struct pio_instr in) {
+    int next;
+
+    if (in.side >= 0)
+        m->side = in.side;
+    if (!pio_model_run(m, &in, 0, &next))
+        return false;
+    if (in.op == PIO_JMP)
+        m->pc = next;
+    return true;
+}
+
+#endif
@@ -0,0 +1,53 @@
+/**
+ * Per-pixel references for the table driven kernels in yuv.c, built on the
+ * libwebp helpers ili9341_lcd.c converted with, to check the kernels bit for bit.
+ *
+ * ref_rgb565_to_yuv422() is not the converter ili9341_lcd.c had: that one passed
+ * the pair sum to VP8RGBToU/V() once and halved the chroma. It takes full-scale
+ * chroma, twice the pair sum, and bit compatibility with the old output was
+ * dropped on purpose.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef REFERENCE_H
+#define REFERENCE_H
+
+#include "yuv.h"
+
+// RGB565 pixel pairs to YUYV words in place, through color16to24() and VP8RGBTo*().
+// VP8RGBToU/V() take the sum of four pixels, the pair's sum goes in twice.
+static inline void ref_rgb565_to_yuv422(uint32_t *data, int len) {
+    for (int i = 0; i < len; i++, data++) {
+        uint16_t first = *data & 0xffff;
+        uint16_t second = (*data >> 16) & 0xffff;
+        uint8_t *dst = (uint8_t *)data;
+        uint8_t rgb1[3], rgb2[3];
+
+        color16to24(first, rgb1);
+        color16to24(second, rgb2);
+        dst[0] = VP8RGBToY(rgb1[0], rgb1[1], rgb1[2], YUV_HALF);
+        dst[2] = VP8RGBToY(rgb2[0], rgb2[1], rgb2[2], YUV_HALF);
+        dst[1] = VP8RGBToU(2 * (rgb1[0] + rgb2[0]), 2 * (rgb1[1] + rgb2[1]), 2 * (rgb1[2] + rgb2[2]), YUV_HALF << 2);
+        dst[3] = VP8RGBToV(2 * (rgb1[0] + rgb2[0]), 2 * (rgb1[1] + rgb2[1]), 2 * (rgb1[2] + rgb2[2]), YUV_HALF << 2);
+    }
+}
+
+// One YUV pixel to RGB565, as yuv422_to_rgb565() fed the LCD FIFO.
+static inline uint16_t ref_yuv_to_rgb565(int y, int u, int v) {
+    uint8_t rgb[2];
+
+    VP8YuvToRgb565(y, u, v, rgb);
+    return (uint16_t)(rgb[0] | rgb[1] << 8);
+}
+
+// YUYV words to RGB565 pixel pairs, first pixel in the low half.
+static inline void ref_yuv422_to_rgb565_words(const uint32_t *src, uint32_t *dst, int len) {
+    for (int i = 0; i < len; i++) {
+        uint32_t px = src[i];
+        int u = (px >> 8) & 0xff, v = px >> 24;
+
+        dst[i] = ref_yuv_to_rgb565(px & 0xff, u, v) | (uint32_t)ref_yuv_to_rgb565((px >> 16) & 0xff, u, v) << 16;
+    }
+}
+
+#endif
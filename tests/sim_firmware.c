@@ -0,0 +1,224 @@
+/**
+ * The sensor, LCD and USB host around the firmware, see sim_firmware.h.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <setjmp.h>
+
+#include "sim_firmware.h"
+#include "test_common.h"
+
+struct sim_sensor sensor;
+struct sim_host host;
+struct sim_lcd lcd;
+struct sim_hooks sim;
+
+static jmp_buf sim_exit;
+static uint8_t in_flight[FRAME_BYTES];
+
+static uint16_t sensor_pixel(uint32_t seq, uint32_t i) {
+    uint32_t x = seq * 0x9e3779b9u ^ i * 0x85ebca6bu;
+    x ^= x >> 15;
+    x *= 0x2c1b3c6du;
+    x ^= x >> 12;
+    return (uint16_t)x;
+}
+
+void sensor_frame(uint32_t seq, uint8_t *dst, uint width, uint height) {
+    for (uint32_t i = 0; i < width * height; i++) {
+        uint16_t p = sensor_pixel(seq, i);
+        dst[2 * i] = (uint8_t)p;
+        dst[2 * i + 1] = (uint8_t)(p >> 8);
+    }
+}
+
+static int sensor_buf_index(uintptr_t addr) {
+    for (int i = 0; i < OV2640_MAX_FRAME_BUFS; i++) {
+        if (sensor.buf_addr[i] == addr)
+            return i;
+    }
+    return -1;
+}
+
+// The raw frame size the capture DMA is armed for, false if it is none of them.
+static bool sensor_size(size_t bytes, uint *width, uint *height) {
+#define SENSOR_SIZE(_frmidx, _width, _height, _fps) \
+    if (bytes == (size_t)(_width) * (_height) * 2) {  \
+        *width = _width;                              \
+        *height = _height;                            \
+        return true;                                  \
+    }
+    UVC_FRAME_SIZES(SENSOR_SIZE)
+#undef SENSOR_SIZE
+    return false;
+}
+
+// Once per simulated us: VSYNC rising edge at the start of each period, then the
+// lines, each written to the capture DMA once it is complete. The state machine
+// only takes the frame if it was waiting on the VSYNC edge, as image.pio does.
+static void sensor_tick(void) {
+    uint64_t t = hal.now_us - sensor.frame_start;
+
+    if (sim.advance)
+        sim.advance();
+
+    if (t >= SENSOR_PERIOD_US) {
+        sensor.frame_start = hal.now_us;
+        sensor.seq++;
+        sensor.frames++;
+        sensor.lines = 0;
+        hal_gpio_edge(PIN_VSYNC, GPIO_IRQ_EDGE_RISE);
+        sensor.capturing = hal.sm[0][CAM_SM].enabled && dma_channel_is_busy(CAM_DMA);
+        if (sensor.capturing) {
+            CHECK(sensor_size(hal.dma[CAM_DMA].hw.transfer_count * 4, &sensor.width, &sensor.height));
+            int i = sensor_buf_index(hal.dma[CAM_DMA].write_addr);
+            if (i < 0)
+                i = sensor_buf_index(0);
+            sensor.buf = hal.dma[CAM_DMA].write_addr;
+            sensor.buf_addr[i] = sensor.buf;
+            sensor.buf_seq[i] = sensor.seq;
+            sensor.buf_width[i] = (uint16_t)sensor.width;
+            sensor.buf_height[i] = (uint16_t)sensor.height;
+        }
+        return;
+    }
+    if (!sensor.capturing || t < SENSOR_VSYNC_US || sensor.lines >= sensor.height ||
+        (t - SENSOR_VSYNC_US) / SENSOR_LINE_US <= sensor.lines)
+        return;
+
+    uint8_t line[FRAME_WIDTH * 2] __attribute__((aligned(4)));
+    for (uint x = 0; x < sensor.width; x++) {
+        uint16_t p = sensor_pixel(sensor.seq, sensor.lines * sensor.width + x);
+        line[2 * x] = (uint8_t)p;
+        line[2 * x + 1] = (uint8_t)(p >> 8);
+    }
+    hal_dma_write(CAM_DMA, line, sensor.width * 2);
+    if (++sensor.lines == sensor.height) {
+        sensor.capturing = false;
+        sensor.captured++;
+        hal_pio_irq(CAM_PIO, CAM_SM);
+    }
+}
+
+// A state machine stopped or restarted mid-frame waits for the next VSYNC.
+static void sensor_sm_enabled(PIO pio, uint sm, bool enabled) {
+    if (pio == CAM_PIO && sm == CAM_SM && !enabled)
+        sensor.capturing = false;
+}
+
+static void sensor_sm_init(PIO pio, uint sm) {
+    if (pio == CAM_PIO && sm == CAM_SM && sim.sensor_init)
+        sim.sensor_init();
+}
+
+// LCD pixels straight out of a frame buffer must still be the sensor's RGB565.
+static void lcd_dma_tx(uint ch, const void *data, size_t bytes) {
+    if (ch == CAM_DMA)
+        return;
+    lcd.bytes += bytes;
+    for (int i = 0; i < OV2640_MAX_FRAME_BUFS; i++) {
+        uintptr_t off = (uintptr_t)data - sensor.buf_addr[i];
+        if (!sensor.buf_addr[i] || off >= (uintptr_t)sensor.buf_width[i] * sensor.buf_height[i] * 2)
+            continue;
+        uint16_t p = sensor_pixel(sensor.buf_seq[i], (uint32_t)off / 2);
+        if (memcmp(data, &p, bytes) != 0)
+            lcd.bad++;
+    }
+}
+
+bool sim_lcd_busy(void) {
+    for (uint ch = 0; ch < count_of(hal.dma); ch++) {
+        if (ch != CAM_DMA && hal.dma[ch].claimed && hal.dma[ch].busy)
+            return true;
+    }
+    return false;
+}
+
+//--------------------------------------------------------------------+
+// tinyusb, as the host sees it
+//--------------------------------------------------------------------+
+bool tud_init(uint8_t rhport) {
+    (void)rhport;
+    return true;
+}
+
+bool tusb_init(void) {
+    return true;
+}
+
+bool tud_mounted(void) {
+    return true;
+}
+
+bool tud_video_n_streaming(uint_fast8_t ctl_idx, uint_fast8_t stm_idx) {
+    (void)ctl_idx;
+    (void)stm_idx;
+    return host.streaming;
+}
+
+bool tud_video_n_frame_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize) {
+    (void)ctl_idx;
+    (void)stm_idx;
+    if (!host.streaming || host.busy)
+        return false;
+    int i = sensor_buf_index((uintptr_t)buffer);
+    CHECK(i >= 0);
+    CHECK(bufsize <= FRAME_BYTES);
+    uint32_t seq = i >= 0 ? sensor.buf_seq[i] : 0;
+    CHECK(seq > host.last_seq); // never the same frame twice, never older
+    host.last_seq = seq;
+    if (sim.xfer && i >= 0)
+        sim.xfer(buffer, bufsize, seq, sensor.buf_width[i], sensor.buf_height[i]);
+
+    host.busy = true;
+    host.buf = buffer;
+    host.size = MIN(bufsize, FRAME_BYTES);
+    memcpy(in_flight, buffer, host.size);
+    host.done_us = hal.now_us + (uint64_t)(bufsize * 1000000 / host.bytes_per_sec);
+    return true;
+}
+
+void sim_commit(unsigned format, unsigned frame) {
+    video_probe_and_commit_control_t commit = {
+        .bFormatIndex = (uint8_t)format,
+        .bFrameIndex = (uint8_t)frame,
+        .dwFrameInterval = 10000000 / FRAME_RATE,
+    };
+    tud_video_commit_cb(0, 0, &commit);
+    if (!host.streaming) {
+        host.streaming = true;
+        host.first_us = hal.now_us;
+    }
+}
+
+// The host side of USB runs between passes of the firmware's main loop.
+void tud_task(void) {
+    hal_advance(TUD_TASK_US);
+    if (sim.tick)
+        sim.tick();
+    if (host.busy && hal.now_us >= host.done_us) {
+        if (memcmp(host.buf, in_flight, host.size) != 0)
+            host.changed++;
+        host.busy = false;
+        host.frames++;
+        host.last_us = hal.now_us;
+        tud_video_frame_xfer_complete_cb(0, 0);
+    }
+    if (hal.now_us >= sim.end_us)
+        longjmp(sim_exit, 1);
+}
+
+void sim_run(void) {
+    hal_reset();
+    hal.tx_bytes_per_us = LCD_BYTES_PER_US;
+    hal.on_advance = sensor_tick;
+    hal.on_sm_enabled = sensor_sm_enabled;
+    hal.on_sm_init = sensor_sm_init;
+    hal.on_dma_tx = lcd_dma_tx;
+    if (!host.bytes_per_sec)
+        host.bytes_per_sec = UVC_STREAM_BYTES_PER_SEC;
+
+    if (!setjmp(sim_exit))
+        firmware_main();
+}
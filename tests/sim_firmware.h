@@ -0,0 +1,103 @@
+/**
+ * The firmware's frame path on the host, for the tests that run main.c: main.c,
+ * ov2640.c and ili9341_lcd.c as built for the board (bare metal, defaults of
+ * main.c), on the pico-sdk model in hal_model.h, with a simulated sensor, LCD
+ * and USB host around them.
+ *
+ * The sensor sends a frame of RGB565 test pixels every SENSOR_PERIOD_US into
+ * whatever the capture DMA is armed with, in the frame size it is armed for. The
+ * LCD PIO drains its DMA at the serial clock, and LCD pixels read straight out
+ * of a frame buffer are checked against the sensor's. The host takes each UVC
+ * frame at host.bytes_per_sec, and a frame buffer must not change while its
+ * transfer is in flight; what the frame holds is up to the test, see sim.xfer.
+ *
+ * Simulated time counts I/O only: conversion and everything else the CPU does
+ * takes none.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef SIM_FIRMWARE_H
+#define SIM_FIRMWARE_H
+
+#include "hal_model.h"
+#include "ov2640.h"
+#include "tusb.h"
+#include "usb_descriptors.h"
+
+// main.c's camera pins and resources.
+#define PIN_VSYNC 3
+#define CAM_PIO pio0
+#define CAM_SM 0
+#define CAM_DMA 0
+
+#define SENSOR_PERIOD_US 33333 // 30 fps
+#define SENSOR_VSYNC_US 1000   // VSYNC to the first line
+#define SENSOR_LINE_US 110     // per line, 240 lines in 26.4 ms
+#define LCD_BYTES_PER_US (133.0 / 2 / 8) // one bit per two PIO cycles at 133 MHz
+#define TUD_TASK_US 10         // each pass of the main loop
+
+#define FRAME_BYTES (FRAME_WIDTH * FRAME_HEIGHT * 2)
+
+struct sim_sensor {
+    uint64_t frame_start;
+    uint32_t seq;         // frame being sent
+    uint width, height;   // its size, from the bytes the DMA was armed for
+    uint lines;           // lines sent of it
+    bool capturing;       // the state machine was waiting on its VSYNC edge
+    uintptr_t buf;        // where the DMA started writing it
+    uint32_t buf_seq[OV2640_MAX_FRAME_BUFS];
+    uint16_t buf_width[OV2640_MAX_FRAME_BUFS], buf_height[OV2640_MAX_FRAME_BUFS];
+    uintptr_t buf_addr[OV2640_MAX_FRAME_BUFS];
+    uint32_t frames, captured;
+};
+
+struct sim_host {
+    uint64_t bytes_per_sec; // UVC_STREAM_BYTES_PER_SEC unless the test sets it
+    bool streaming, busy;
+    uint64_t done_us;
+    const uint8_t *buf;
+    size_t size;
+    uint32_t last_seq;
+    uint32_t frames, changed;
+    uint64_t first_us, last_us;
+};
+
+struct sim_lcd {
+    uint64_t bytes;
+    uint32_t bad;
+};
+
+// Set by the test before sim_run().
+struct sim_hooks {
+    uint64_t end_us; // firmware_main() is left at this time
+    // Every pass of the main loop, before the host's transfer completes.
+    void (*tick)(void);
+    // Every simulated us, also while the firmware waits on the LCD or the sensor:
+    // with tud_task in a task of its own, a commit can arrive at any time.
+    void (*advance)(void);
+    // Every frame the firmware queues on the stream, captured as frame seq of
+    // width x height.
+    void (*xfer)(const uint8_t *buf, size_t size, uint32_t seq, uint width, uint height);
+    // The camera's state machine is (re)initialised for a new mode.
+    void (*sensor_init)(void);
+};
+
+extern struct sim_sensor sensor;
+extern struct sim_host host;
+extern struct sim_lcd lcd;
+extern struct sim_hooks sim;
+
+int firmware_main(void);
+void tud_video_frame_xfer_complete_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx);
+int tud_video_commit_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, video_probe_and_commit_control_t const *parameters);
+
+// The RGB565 test pixels of frame seq, different in every frame.
+void sensor_frame(uint32_t seq, uint8_t *dst, uint width, uint height);
+// The host commits a format and frame at FRAME_RATE, and streams from then on.
+void sim_commit(unsigned format, unsigned frame);
+// Whether the LCD DMA is pushing pixels.
+bool sim_lcd_busy(void);
+// Boot the firmware and run it until sim.end_us.
+void sim_run(void);
+
+#endif
@@ -0,0 +1,16 @@
+/* Host stand-in for FreeRTOS.h: the types and config video_pacing.h uses, with
+ * the tick rate of FreeRTOSConfig/FreeRTOSConfig.h. */
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+
+#define configTICK_RATE_HZ ((TickType_t)20000)
+
+#endif
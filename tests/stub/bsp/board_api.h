@@ -0,0 +1,16 @@
+/* Host stand-in for tinyusb's bsp/board_api.h, for usb_descriptors.c and main.c.
+ * hal_model.c implements the calls on its clock. */
+#ifndef BOARD_API_H_
+#define BOARD_API_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+void board_init(void);
+void board_led_write(bool state);
+uint32_t board_millis(void);
+void board_init_after_tusb(void) __attribute__((weak));
+
+#endif
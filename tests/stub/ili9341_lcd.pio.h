@@ -0,0 +1,39 @@
+/* Host stand-in for the ili9341_lcd.pio.h pioasm generates: ili9341_lcd.pio
+ * assembled by hand, then its c-sdk block, which CMake copies out of
+ * ili9341_lcd.pio into ili9341_lcd.pio.c-sdk.h. */
+#ifndef ILI9341_LCD_PIO_H
+#define ILI9341_LCD_PIO_H
+
+#include "hardware/pio.h"
+
+#define ili9341_lcd_wrap_target 0
+#define ili9341_lcd_wrap 1
+
+#define ili9341_lcd_start_8 0
+#define ili9341_lcd_set_addr_window 3
+#define ili9341_lcd_block_fill 17
+#define ili9341_lcd_start_tx 27
+
+static const uint16_t ili9341_lcd_program_instructions[] = {
+    //     .wrap_target
+    0x6001, //  0: out    pins, 1         side 0
+    0xb042, //  1: nop                    side 1
+    //     .wrap
+};
+
+static const struct pio_program ili9341_lcd_program = {
+    .instructions = ili9341_lcd_program_instructions,
+    .length = 2,
+    .origin = -1,
+};
+
+static inline pio_sm_config ili9341_lcd_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + ili9341_lcd_wrap_target, offset + ili9341_lcd_wrap);
+    sm_config_set_sideset(&c, 1, false, false);
+    return c;
+}
+
+#include "ili9341_lcd.pio.c-sdk.h"
+
+#endif
@@ -0,0 +1,48 @@
+/* Host stand-in for the image.pio.h pioasm generates: image.pio assembled by
+ * hand, then its c-sdk block, which CMake copies out of image.pio into
+ * image.pio.c-sdk.h. test_image_pio checks the offsets against the source. */
+#ifndef IMAGE_PIO_H
+#define IMAGE_PIO_H
+
+#include "hardware/pio.h"
+
+#define image_wrap_target 0
+#define image_wrap 11
+
+#define image_offset_vsync_low 1u
+#define image_offset_vsync_high 2u
+#define image_offset_line 3u
+#define image_offset_line_end 9u
+
+static const uint16_t image_program_instructions[] = {
+    //     .wrap_target
+    0xa041, //  0: mov    y, x
+    0x2000, //  1: wait   0 gpio, 0
+    0x2080, //  2: wait   1 gpio, 0
+    0x20a9, //  3: wait   1 pin, 9
+    0x2028, //  4: wait   0 pin, 8
+    0x20a8, //  5: wait   1 pin, 8
+    0x4008, //  6: in     pins, 8
+    0x2028, //  7: wait   0 pin, 8
+    0x00c5, //  8: jmp    pin, 5
+    0xa0c3, //  9: mov    isr, null
+    0x0083, // 10: jmp    y--, 3
+    0xc010, // 11: irq    nowait 0 rel
+    //     .wrap
+};
+
+static const struct pio_program image_program = {
+    .instructions = image_program_instructions,
+    .length = 12,
+    .origin = -1,
+};
+
+static inline pio_sm_config image_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + image_wrap_target, offset + image_wrap);
+    return c;
+}
+
+#include "image.pio.c-sdk.h"
+
+#endif
@@ -0,0 +1,13 @@
+/* Host stand-in for FreeRTOS's task.h: the tick calls video_pacing.h makes, which
+ * a test implements on a tick count of its own. */
+#ifndef INC_TASK_H
+#define INC_TASK_H
+
+#include "FreeRTOS.h"
+
+TickType_t xTaskGetTickCount(void);
+// Block until *previous_wake + increment, and move *previous_wake there. Returns
+// pdFALSE without blocking if that time has already passed.
+BaseType_t xTaskDelayUntil(TickType_t *previous_wake, TickType_t increment);
+
+#endif
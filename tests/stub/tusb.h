@@ -0,0 +1,201 @@
+/* Host stand-in for tinyusb's tusb.h: the types, constants and descriptor
+ * templates usb_descriptors.c and usb_descriptors.h use, laid out byte for byte
+ * as in tinyusb's usbd.h and class/video/video_device.h, and the device calls
+ * main.c makes, which a test that runs main.c implements. */
+#ifndef _TUSB_H_
+#define _TUSB_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define OPT_MCU_RP2040 1900
+#define OPT_OS_NONE 1
+#define OPT_MODE_DEFAULT_SPEED 0
+#define CFG_TUSB_MCU OPT_MCU_RP2040
+#include "tusb_config.h"
+
+#ifndef CFG_TUD_CDC
+#define CFG_TUD_CDC 0
+#endif
+#ifndef CFG_TUD_MSC
+#define CFG_TUD_MSC 0
+#endif
+#ifndef CFG_TUD_HID
+#define CFG_TUD_HID 0
+#endif
+#ifndef CFG_TUD_MIDI
+#define CFG_TUD_MIDI 0
+#endif
+#ifndef CFG_TUD_AUDIO
+#define CFG_TUD_AUDIO 0
+#endif
+#ifndef CFG_TUD_VENDOR
+#define CFG_TUD_VENDOR 0
+#endif
+
+typedef struct __attribute__((packed)) {
+    uint8_t bLength, bDescriptorType;
+    uint16_t bcdUSB;
+    uint8_t bDeviceClass, bDeviceSubClass, bDeviceProtocol, bMaxPacketSize0;
+    uint16_t idVendor, idProduct, bcdDevice;
+    uint8_t iManufacturer, iProduct, iSerialNumber, bNumConfigurations;
+} tusb_desc_device_t;
+
+enum {
+    TUSB_DESC_DEVICE = 1,
+    TUSB_DESC_CONFIGURATION = 2,
+    TUSB_DESC_STRING = 3,
+    TUSB_DESC_INTERFACE = 4,
+    TUSB_DESC_ENDPOINT = 5,
+    TUSB_DESC_INTERFACE_ASSOCIATION = 11,
+    TUSB_DESC_CS_INTERFACE = 0x24,
+};
+#define TUSB_CLASS_MISC 0xef
+#define MISC_SUBCLASS_COMMON 2
+#define MISC_PROTOCOL_IAD 1
+#define TUSB_CLASS_VIDEO 14
+
+#define U16_TO_U8S_LE(x) (uint8_t)((x) & 0xff), (uint8_t)(((x) >> 8) & 0xff)
+#define U24_TO_U8S_LE(x) U16_TO_U8S_LE(x), (uint8_t)(((x) >> 16) & 0xff)
+#define U32_TO_U8S_LE(x) U16_TO_U8S_LE((x) & 0xffff), U16_TO_U8S_LE(((x) >> 16) & 0xffff)
+#define TU_ARGS_NUM(...) TU_ARGS_NUM_(__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define TU_ARGS_NUM_(_1, _2, _3, _4, _5, _6, _7, _8, N, ...) N
+
+#define TUD_CONFIG_DESC_LEN 9
+#define TUD_CONFIG_DESCRIPTOR(config_num, _itfcount, _stridx, _total_len, _attribute, _power_ma) \
+    9, TUSB_DESC_CONFIGURATION, U16_TO_U8S_LE(_total_len), _itfcount, config_num, _stridx, \
+        (1 << 7) | _attribute, (_power_ma) / 2
+
+// Video class
+#define VIDEO_TT_STREAMING 0x0101
+#define VIDEO_ITT_CAMERA 0x0201
+#define VIDEO_COLOR_PRIMARIES_BT709 1
+#define VIDEO_COLOR_XFER_CH_BT709 1
+#define VIDEO_COLOR_COEF_SMPTE170M 4
+enum {
+    VIDEO_SUBCLASS_CONTROL = 1,
+    VIDEO_SUBCLASS_STREAMING = 2,
+    VIDEO_SUBCLASS_INTERFACE_COLLECTION = 3,
+};
+#define VIDEO_ITF_PROTOCOL_UNDEFINED 0
+#define VIDEO_ITF_PROTOCOL_15 1
+enum {
+    VIDEO_CS_ITF_VC_HEADER = 1,
+    VIDEO_CS_ITF_VC_INPUT_TERMINAL = 2,
+    VIDEO_CS_ITF_VC_OUTPUT_TERMINAL = 3,
+};
+enum {
+    VIDEO_CS_ITF_VS_INPUT_HEADER = 1,
+    VIDEO_CS_ITF_VS_FORMAT_UNCOMPRESSED = 4,
+    VIDEO_CS_ITF_VS_FRAME_UNCOMPRESSED = 5,
+    VIDEO_CS_ITF_VS_FORMAT_MJPEG = 6,
+    VIDEO_CS_ITF_VS_FRAME_MJPEG = 7,
+    VIDEO_CS_ITF_VS_COLORFORMAT = 13,
+};
+
+#define TUD_VIDEO_GUID(_g0, _g1, _g2, _g3) _g0, _g1, _g2, _g3, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+#define TUD_VIDEO_GUID_YUY2 TUD_VIDEO_GUID('Y', 'U', 'Y', '2')
+#define TUD_VIDEO_GUID_NV12 TUD_VIDEO_GUID('N', 'V', '1', '2')
+#define TUD_VIDEO_GUID_NV21 TUD_VIDEO_GUID('N', 'V', '2', '1')
+#define TUD_VIDEO_GUID_M420 TUD_VIDEO_GUID('M', '4', '2', '0')
+#define TUD_VIDEO_GUID_I420 TUD_VIDEO_GUID('I', '4', '2', '0')
+
+#define TUD_VIDEO_DESC_IAD_LEN 8
+#define TUD_VIDEO_DESC_STD_VC_LEN 9
+#define TUD_VIDEO_DESC_CS_VC_LEN 12
+#define TUD_VIDEO_DESC_INPUT_TERM_LEN 8
+#define TUD_VIDEO_DESC_OUTPUT_TERM_LEN 9
+#define TUD_VIDEO_DESC_CAMERA_TERM_LEN 18
+#define TUD_VIDEO_DESC_STD_VS_LEN 9
+#define TUD_VIDEO_DESC_CS_VS_IN_LEN 13
+#define TUD_VIDEO_DESC_CS_VS_OUT_LEN 9
+#define TUD_VIDEO_DESC_CS_VS_FMT_UNCOMPR_LEN 27
+#define TUD_VIDEO_DESC_CS_VS_FMT_MJPEG_LEN 11
+#define TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT_LEN 38
+#define TUD_VIDEO_DESC_CS_VS_FRM_MJPEG_CONT_LEN 38
+#define TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING_LEN 6
+
+#define TUD_VIDEO_DESC_IAD(_firstitf, _nitfs, _stridx) \
+    TUD_VIDEO_DESC_IAD_LEN, TUSB_DESC_INTERFACE_ASSOCIATION, _firstitf, _nitfs, TUSB_CLASS_VIDEO, \
+        VIDEO_SUBCLASS_INTERFACE_COLLECTION, VIDEO_ITF_PROTOCOL_UNDEFINED, _stridx
+#define TUD_VIDEO_DESC_STD_VC(_itfnum, _nEPs, _stridx) \
+    TUD_VIDEO_DESC_STD_VC_LEN, TUSB_DESC_INTERFACE, _itfnum, 0, _nEPs, TUSB_CLASS_VIDEO, \
+        VIDEO_SUBCLASS_CONTROL, VIDEO_ITF_PROTOCOL_15, _stridx
+#define TUD_VIDEO_DESC_CS_VC(_bcdUVC, _totallen, _clkfreq, ...) \
+    TUD_VIDEO_DESC_CS_VC_LEN + (TU_ARGS_NUM(__VA_ARGS__)), TUSB_DESC_CS_INTERFACE, VIDEO_CS_ITF_VC_HEADER, \
+        U16_TO_U8S_LE(_bcdUVC), U16_TO_U8S_LE((_totallen) + TUD_VIDEO_DESC_CS_VC_LEN + (TU_ARGS_NUM(__VA_ARGS__))), \
+        U32_TO_U8S_LE(_clkfreq), TU_ARGS_NUM(__VA_ARGS__), __VA_ARGS__
+#define TUD_VIDEO_DESC_OUTPUT_TERM(_tid, _tt, _at, _srcid, _stridx) \
+    TUD_VIDEO_DESC_OUTPUT_TERM_LEN, TUSB_DESC_CS_INTERFACE, VIDEO_CS_ITF_VC_OUTPUT_TERMINAL, _tid, \
+        U16_TO_U8S_LE(_tt), _at, _srcid, _stridx
+#define TUD_VIDEO_DESC_CAMERA_TERM(_tid, _at, _stridx, _focal_min, _focal_max, _focal, _ctls) \
+    TUD_VIDEO_DESC_CAMERA_TERM_LEN, TUSB_DESC_CS_INTERFACE, VIDEO_CS_ITF_VC_INPUT_TERMINAL, _tid, \
+        U16_TO_U8S_LE(VIDEO_ITT_CAMERA), _at, _stridx, U16_TO_U8S_LE(_focal_min), U16_TO_U8S_LE(_focal_max), \
+        U16_TO_U8S_LE(_focal), 3, U24_TO_U8S_LE(_ctls)
+#define TUD_VIDEO_DESC_STD_VS(_itfnum, _alt, _epn, _stridx) \
+    TUD_VIDEO_DESC_STD_VS_LEN, TUSB_DESC_INTERFACE, _itfnum, _alt, _epn, TUSB_CLASS_VIDEO, \
+        VIDEO_SUBCLASS_STREAMING, VIDEO_ITF_PROTOCOL_15, _stridx
+#define TUD_VIDEO_DESC_CS_VS_INPUT(_numfmt, _totallen, _ep, _inf, _termlnk, _sm, _trg, _tm, ...) \
+    TUD_VIDEO_DESC_CS_VS_IN_LEN + (_numfmt), TUSB_DESC_CS_INTERFACE, VIDEO_CS_ITF_VS_INPUT_HEADER, _numfmt, \
+        U16_TO_U8S_LE((_totallen) + TUD_VIDEO_DESC_CS_VS_IN_LEN + (_numfmt)), _ep, _inf, _termlnk, _sm, _trg, \
+        _tm, 1, __VA_ARGS__
+#define TUD_VIDEO_DESC_CS_VS_FMT_UNCOMPR(_fmtidx, _numfmtdesc, _guid, _bitsperpix, _frmidx, _asrx, _asry, _interlace, _cp) \
+    TUD_VIDEO_DESC_CS_VS_FMT_UNCOMPR_LEN, TUSB_DESC_CS_INTERFACE, VIDEO_CS_ITF_VS_FORMAT_UNCOMPRESSED, _fmtidx, \
+        _numfmtdesc, _guid, _bitsperpix, _frmidx, _asrx, _asry, _interlace, _cp
+#define TUD_VIDEO_DESC_CS_VS_FMT_MJPEG(_fmtidx, _numfmtdesc, _fixed_sz, _frmidx, _asrx, _asry, _interlace, _cp) \
+    TUD_VIDEO_DESC_CS_VS_FMT_MJPEG_LEN, TUSB_DESC_CS_INTERFACE, VIDEO_CS_ITF_VS_FORMAT_MJPEG, _fmtidx, \
+        _numfmtdesc, _fixed_sz, _frmidx, _asrx, _asry, _interlace, _cp
+#define TUD_VIDEO_DESC_CS_VS_FRM_CONT(_subtype, _frmidx, _cap, _width, _height, _minbr, _maxbr, _maxfrmbufsz, \
+                                      _frminterval, _minfrminterval, _maxfrminterval, _frmintervalstep) \
+    TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT_LEN, TUSB_DESC_CS_INTERFACE, _subtype, _frmidx, _cap, \
+        U16_TO_U8S_LE(_width), U16_TO_U8S_LE(_height), U32_TO_U8S_LE(_minbr), U32_TO_U8S_LE(_maxbr), \
+        U32_TO_U8S_LE(_maxfrmbufsz), U32_TO_U8S_LE(_frminterval), 0, U32_TO_U8S_LE(_minfrminterval), \
+        U32_TO_U8S_LE(_maxfrminterval), U32_TO_U8S_LE(_frmintervalstep)
+#define TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT(...) \
+    TUD_VIDEO_DESC_CS_VS_FRM_CONT(VIDEO_CS_ITF_VS_FRAME_UNCOMPRESSED, __VA_ARGS__)
+#define TUD_VIDEO_DESC_CS_VS_FRM_MJPEG_CONT(...) TUD_VIDEO_DESC_CS_VS_FRM_CONT(VIDEO_CS_ITF_VS_FRAME_MJPEG, __VA_ARGS__)
+#define TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING(_color, _trns, _mat) \
+    TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING_LEN, TUSB_DESC_CS_INTERFACE, VIDEO_CS_ITF_VS_COLORFORMAT, _color, _trns, _mat
+#define TUD_VIDEO_DESC_EP_BULK(_epin, _epsize, _ep_interval) \
+    7, TUSB_DESC_ENDPOINT, _epin, 2, U16_TO_U8S_LE(_epsize), _ep_interval
+#define TUD_VIDEO_DESC_EP_ISO(_epin, _epsize, _ep_interval) \
+    7, TUSB_DESC_ENDPOINT, _epin, 1 | 4, U16_TO_U8S_LE(_epsize), _ep_interval
+
+// Device stack
+typedef struct __attribute__((packed)) {
+    uint16_t bmHint;
+    uint8_t bFormatIndex;
+    uint8_t bFrameIndex;
+    uint32_t dwFrameInterval;
+    uint16_t wKeyFrameRate;
+    uint16_t wPFrameRate;
+    uint16_t wCompQuality;
+    uint16_t wCompWindowSize;
+    uint16_t wDelay;
+    uint32_t dwMaxVideoFrameSize;
+    uint32_t dwMaxPayloadTransferSize;
+    uint32_t dwClockFrequency;
+    uint8_t bmFramingInfo;
+    uint8_t bPreferedVersion;
+    uint8_t bMinVersion;
+    uint8_t bMaxVersion;
+    uint8_t bUsage;
+    uint8_t bBitDepthLuma;
+    uint8_t bmSettings;
+    uint8_t bMaxNumberOfRefFramesPlus1;
+    uint16_t bmRateControlModes;
+    uint64_t bmLayoutPerStream;
+} video_probe_and_commit_control_t;
+
+#define VIDEO_ERROR_NONE 0
+
+bool tud_init(uint8_t rhport);
+bool tusb_init(void);
+void tud_task(void);
+bool tud_mounted(void);
+bool tud_video_n_streaming(uint_fast8_t ctl_idx, uint_fast8_t stm_idx);
+bool tud_video_n_frame_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize);
+
+#endif
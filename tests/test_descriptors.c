@@ -0,0 +1,237 @@
+/**
+ * The configuration descriptor of usb_descriptors.c, parsed the way a host does:
+ * descriptor lengths and totals, the formats with their GUIDs and frame descriptors,
+ * and that every frame interval offered fits in what the streaming endpoint can carry.
+ * Built once for isochronous and once for bulk streaming.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+
+#include "test_common.h"
+#include "tusb.h"
+#include "usb_descriptors.h"
+
+uint8_t const *tud_descriptor_configuration_cb(uint8_t index);
+
+#define VS_HEADER_SIZE 2 // tinyusb's payload header, no PTS or SCR
+
+static inline uint16_t get16(const uint8_t *p) {
+    return p[0] | p[1] << 8;
+}
+
+static inline uint32_t get32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+struct frame_size {
+    uint16_t width, height;
+};
+
+#define FRAME_SIZE(_frmidx, _width, _height, _fps) {_width, _height},
+static const struct frame_size frame_sizes[] = {UVC_FRAME_SIZES(FRAME_SIZE)};
+static const struct frame_size mjpeg_frame_sizes[] = {UVC_MJPEG_FRAME_SIZES(FRAME_SIZE)};
+
+struct format {
+    uint8_t subtype, index, frames, bpp, seen;
+    char fourcc[5]; // first four bytes of the GUID of an uncompressed format
+};
+
+// What each bFormatIndex has to advertise. RGBP is RGB565 as captured, so it
+// takes the bytes of YUY2 per pixel.
+static const struct {
+    const char *fourcc;
+    uint8_t bpp;
+} expected_formats[UVC_FORMAT_COUNT + 1] = {
+    [UVC_FORMAT_YUY2] = {"YUY2", 16}, [UVC_FORMAT_GREY] = {"Y800", 8}, [UVC_FORMAT_NV12] = {"NV12", 12},
+    [UVC_FORMAT_I420] = {"I420", 12}, [UVC_FORMAT_RGBP] = {"RGBP", 16},
+};
+
+// The fixed tail of the GUIDs of the uncompressed formats, after the fourcc.
+static const uint8_t guid_tail[12] = {0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+
+struct stream_ep {
+    uint8_t alt, attributes;
+    uint16_t size;
+};
+
+struct parsed {
+    unsigned vs_total, vs_len, vs_formats, frames;
+    struct format formats[UVC_FORMAT_COUNT + 1];
+    struct stream_ep eps[UVC_ISO_ALT_COUNT + 1];
+    unsigned ep_count;
+    uint64_t bytes_per_sec;
+};
+
+// The endpoint descriptors come after the formats, so the frames are checked in a
+// second pass once the stream bandwidth is known.
+static void check_frame(const struct parsed *p, const struct format *fmt, const uint8_t *d) {
+    const struct frame_size *sizes = fmt->subtype == VIDEO_CS_ITF_VS_FORMAT_MJPEG ? mjpeg_frame_sizes : frame_sizes;
+    unsigned idx = d[3], width = get16(d + 5), height = get16(d + 7);
+    uint32_t max_br = get32(d + 13), buf_size = get32(d + 17), dflt = get32(d + 21);
+    uint32_t min = get32(d + 26), max = get32(d + 30), step = get32(d + 34);
+    uint64_t bytes;
+
+    CHECK(d[0] == TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT_LEN);
+    CHECK(d[2] == fmt->subtype + 1);
+    CHECK(idx >= 1 && idx <= fmt->frames);
+    if (idx < 1 || idx > fmt->frames)
+        return;
+    CHECK(width == sizes[idx - 1].width && height == sizes[idx - 1].height);
+    CHECK(d[25] == 0); // continuous
+
+    if (fmt->subtype == VIDEO_CS_ITF_VS_FORMAT_MJPEG) {
+        bytes = (uint64_t)width * height * 2 / 8;
+        CHECK(buf_size == UVC_MJPEG_MAX_FRAME_SIZE);
+    } else {
+        bytes = (uint64_t)width * height * fmt->bpp / 8;
+        CHECK(buf_size == bytes);
+    }
+
+    CHECK(step != 0);
+    CHECK(min <= dflt && dflt <= max);
+    if (step) {
+        CHECK((max - min) % step == 0);
+        CHECK((dflt - min) % step == 0);
+    }
+    CHECK(max <= 10000000 || max == min);
+    // The fastest rate offered has to fit through the endpoint.
+    CHECK(min && bytes * 10000000 <= p->bytes_per_sec * min);
+    CHECK(max_br == bytes * 8 * 10000000 / min);
+}
+
+static void parse(const uint8_t *cfg, struct parsed *p) {
+    unsigned total = get16(cfg + 2);
+    unsigned vs_itf = 0, alt = 0;
+    struct format *fmt = NULL;
+    const uint8_t *d;
+
+    memset(p, 0, sizeof(*p));
+    CHECK(cfg[1] == TUSB_DESC_CONFIGURATION);
+    for (d = cfg; d < cfg + total; d += d[0]) {
+        CHECK(d[0] >= 2 && d + d[0] <= cfg + total);
+        if (d[0] < 2 || d + d[0] > cfg + total)
+            return;
+        switch (d[1]) {
+        case TUSB_DESC_INTERFACE:
+            CHECK(d[0] == 9);
+            vs_itf = d[5] == TUSB_CLASS_VIDEO && d[6] == VIDEO_SUBCLASS_STREAMING;
+            alt = d[3];
+            break;
+        case TUSB_DESC_ENDPOINT:
+            CHECK(d[0] == 7);
+            CHECK(vs_itf && d[2] == 0x81);
+            CHECK(p->ep_count <= UVC_ISO_ALT_COUNT);
+            if (p->ep_count <= UVC_ISO_ALT_COUNT)
+                p->eps[p->ep_count++] = (struct stream_ep){alt, d[3], get16(d + 4)};
+            break;
+        case TUSB_DESC_CS_INTERFACE:
+            if (!vs_itf)
+                break;
+            switch (d[2]) {
+            case VIDEO_CS_ITF_VS_INPUT_HEADER:
+                p->vs_formats = d[3];
+                p->vs_total = get16(d + 4);
+                CHECK(d[6] == 0x81);
+                CHECK(d[0] == TUD_VIDEO_DESC_CS_VS_IN_LEN + d[3] * d[12]);
+                break;
+            case VIDEO_CS_ITF_VS_FORMAT_UNCOMPRESSED:
+            case VIDEO_CS_ITF_VS_FORMAT_MJPEG:
+                CHECK(d[3] >= 1 && d[3] <= UVC_FORMAT_COUNT);
+                if (d[3] < 1 || d[3] > UVC_FORMAT_COUNT) {
+                    fmt = NULL;
+                    break;
+                }
+                fmt = &p->formats[d[3]];
+                CHECK(!fmt->seen);
+                fmt->seen = 1;
+                fmt->subtype = d[2];
+                fmt->index = d[3];
+                fmt->frames = d[4];
+                if (d[2] == VIDEO_CS_ITF_VS_FORMAT_UNCOMPRESSED) {
+                    CHECK(d[0] == TUD_VIDEO_DESC_CS_VS_FMT_UNCOMPR_LEN);
+                    fmt->bpp = d[21];
+                    memcpy(fmt->fourcc, d + 5, 4);
+                    CHECK(memcmp(d + 9, guid_tail, sizeof(guid_tail)) == 0);
+                    CHECK(d[4] == UVC_FRAME_COUNT);
+                } else {
+                    CHECK(d[0] == TUD_VIDEO_DESC_CS_VS_FMT_MJPEG_LEN);
+                    CHECK(d[4] == UVC_MJPEG_FRAME_COUNT);
+                }
+                break;
+            case VIDEO_CS_ITF_VS_FRAME_UNCOMPRESSED:
+            case VIDEO_CS_ITF_VS_FRAME_MJPEG:
+                CHECK(fmt != NULL);
+                p->frames++;
+                break;
+            }
+            p->vs_len += d[0];
+            break;
+        }
+    }
+    CHECK(d == cfg + total);
+}
+
+static void check_frames(const uint8_t *cfg, const struct parsed *p) {
+    const struct format *fmt = NULL;
+    const uint8_t *d;
+
+    for (d = cfg; d < cfg + get16(cfg + 2); d += d[0]) {
+        if (d[1] != TUSB_DESC_CS_INTERFACE)
+            continue;
+        if ((d[2] == VIDEO_CS_ITF_VS_FORMAT_UNCOMPRESSED || d[2] == VIDEO_CS_ITF_VS_FORMAT_MJPEG) && d[3] >= 1 &&
+            d[3] <= UVC_FORMAT_COUNT)
+            fmt = &p->formats[d[3]];
+        else if ((d[2] == VIDEO_CS_ITF_VS_FRAME_UNCOMPRESSED || d[2] == VIDEO_CS_ITF_VS_FRAME_MJPEG) && fmt)
+            check_frame(p, fmt, d);
+    }
+}
+
+int main(void) {
+    const uint8_t *cfg = tud_descriptor_configuration_cb(0);
+    struct parsed p;
+    unsigned i;
+
+    parse(cfg, &p);
+
+    // The VS input header's wTotalLength covers it and everything after it up to
+    // the endpoint descriptors.
+    CHECK(p.vs_total == p.vs_len);
+    CHECK(p.vs_formats == UVC_FORMAT_COUNT);
+    CHECK(p.frames == UVC_FRAME_COUNT * (UVC_FORMAT_COUNT - 1) + UVC_MJPEG_FRAME_COUNT);
+    for (i = 1; i <= UVC_FORMAT_COUNT; i++)
+        CHECK(p.formats[i].seen);
+    CHECK(p.formats[UVC_FORMAT_MJPEG].subtype == VIDEO_CS_ITF_VS_FORMAT_MJPEG);
+    for (i = 1; i <= UVC_FORMAT_COUNT; i++) {
+        if (!expected_formats[i].fourcc)
+            continue;
+        CHECK(p.formats[i].subtype == VIDEO_CS_ITF_VS_FORMAT_UNCOMPRESSED);
+        CHECK(strcmp(p.formats[i].fourcc, expected_formats[i].fourcc) == 0);
+        CHECK(p.formats[i].bpp == expected_formats[i].bpp);
+    }
+
+#if CFG_TUD_VIDEO_STREAMING_BULK
+    CHECK(p.ep_count == 1);
+    CHECK(p.eps[0].alt == 0 && p.eps[0].attributes == 2 && p.eps[0].size == 64);
+    // At most 19 64 byte bulk packets fit in a full speed frame.
+    p.bytes_per_sec = 19 * 64 * 1000ULL;
+#else
+    static const uint16_t iso_sizes[UVC_ISO_ALT_COUNT] = {128, 256, 512, 1023};
+    CHECK(p.ep_count == UVC_ISO_ALT_COUNT);
+    for (i = 0; i < p.ep_count && i < UVC_ISO_ALT_COUNT; i++) {
+        CHECK(p.eps[i].alt == i + 1);
+        CHECK(p.eps[i].attributes == 5);
+        CHECK(p.eps[i].size == iso_sizes[i]);
+    }
+    // One packet of the largest alternate setting per 1 ms frame, less its header.
+    p.bytes_per_sec = (uint64_t)(iso_sizes[UVC_ISO_ALT_COUNT - 1] - VS_HEADER_SIZE) * 1000;
+#endif
+    check_frames(cfg, &p);
+
+#if CFG_TUD_VIDEO_STREAMING_BULK
+    return test_result("test_descriptors_bulk");
+#else
+    return test_result("test_descriptors");
+#endif
+}
@@ -0,0 +1,187 @@
+/**
+ * frame_pool.c, the frame buffer ownership behind ov2640_capture_get_frame(),
+ * _ref_frame() and _release_frame(): a frame held by both the LCD and UVC is
+ * free only once both let go; frames held by each are freed in whichever order
+ * they are released; capture finds no buffer while all are held; and a frame
+ * with references is never recycled or captured into, also under a random mix
+ * of captures and consumers.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "frame_pool.h"
+#include "test_common.h"
+
+static struct frame_pool pool;
+
+// Capture a frame into the next free buffer and make it READY.
+static int capture_frame(void) {
+    int i = frame_pool_capture(&pool);
+    if (i >= 0)
+        CHECK(frame_pool_ready(&pool) == i);
+    return i;
+}
+
+// UVC takes the frame and the LCD a second reference: either release leaves it
+// in use, the second one frees it.
+static void shared_frame(void) {
+    frame_pool_init(&pool, 2);
+    int i = capture_frame();
+    CHECK(i == 0);
+    CHECK(frame_pool_get(&pool) == i); // UVC
+    CHECK(frame_pool_ref(&pool, i));   // LCD
+    CHECK(pool.refs[i] == 2);
+
+    CHECK(!frame_pool_release(&pool, i));
+    CHECK(pool.state[i] == FRAME_IN_USE);
+    CHECK(frame_pool_capture(&pool) == 1);
+    frame_pool_abort(&pool);
+    CHECK(frame_pool_release(&pool, i));
+    CHECK(pool.state[i] == FRAME_FREE);
+
+    // Releasing it again does nothing, and neither does a reference.
+    CHECK(!frame_pool_release(&pool, i));
+    CHECK(!frame_pool_ref(&pool, i));
+    CHECK(pool.state[i] == FRAME_FREE && pool.refs[i] == 0);
+}
+
+// The LCD still pushes frame a while UVC already sends the newer frame b; they
+// let go in either order, and each buffer is free only once its holder is done.
+static void release_order(bool newest_first) {
+    frame_pool_init(&pool, 3);
+    int a = capture_frame();
+    CHECK(frame_pool_get(&pool) == a);
+    CHECK(frame_pool_ref(&pool, a));
+    CHECK(!frame_pool_release(&pool, a)); // UVC is done with a
+    int b = capture_frame();
+    CHECK(frame_pool_get(&pool) == b);
+
+    int first = newest_first ? b : a, second = newest_first ? a : b;
+    CHECK(frame_pool_release(&pool, first));
+    CHECK(pool.state[first] == FRAME_FREE && pool.state[second] == FRAME_IN_USE);
+    int c = frame_pool_capture(&pool);
+    CHECK(c >= 0 && c != second);
+    CHECK(frame_pool_ready(&pool) == c);
+    CHECK(frame_pool_release(&pool, second));
+    CHECK(pool.state[second] == FRAME_FREE);
+    CHECK(frame_pool_get(&pool) == c);
+}
+
+static void no_free_buffer(void) {
+    frame_pool_init(&pool, 2);
+    int a = capture_frame();
+    CHECK(frame_pool_get(&pool) == a);
+    int b = capture_frame();
+    CHECK(b >= 0 && b != a);
+    CHECK(frame_pool_get(&pool) == b);
+
+    // Both held: nothing to capture into, and nothing ready.
+    CHECK(frame_pool_capture(&pool) == -1);
+    CHECK(pool.capturing == -1);
+    CHECK(frame_pool_get(&pool) == -1);
+    CHECK(frame_pool_ready(&pool) == -1);
+
+    // One READY and one held is still no free buffer: the READY frame is only
+    // replaced by a newer one, never captured over.
+    CHECK(frame_pool_release(&pool, b));
+    CHECK(capture_frame() == b);
+    CHECK(frame_pool_capture(&pool) == -1);
+    CHECK(pool.state[a] == FRAME_IN_USE && pool.state[b] == FRAME_READY);
+
+    // Only one buffer is captured into at a time.
+    CHECK(frame_pool_release(&pool, a));
+    CHECK(frame_pool_capture(&pool) == a);
+    CHECK(frame_pool_capture(&pool) == -1);
+}
+
+// A frame taken by a consumer stays put while newer frames replace each other.
+static void held_not_recycled(void) {
+    frame_pool_init(&pool, 3);
+    int held = capture_frame();
+    CHECK(frame_pool_get(&pool) == held);
+    CHECK(frame_pool_ref(&pool, held));
+
+    for (int n = 0; n < 10; n++) {
+        int i = capture_frame();
+        CHECK(i >= 0 && i != held);
+        CHECK(pool.state[held] == FRAME_IN_USE && pool.refs[held] == 2);
+    }
+    CHECK(pool.dropped == 9);
+
+    // The newest frame is the one handed out next, set_mode's flush drops it.
+    frame_pool_flush(&pool);
+    CHECK(frame_pool_get(&pool) == -1);
+    CHECK(pool.state[held] == FRAME_IN_USE);
+}
+
+// Random captures, aborts, gets, refs and releases, against the references the
+// consumers know they hold.
+static void stress(void) {
+    uint8_t held[FRAME_POOL_MAX_BUFS] = {0};
+    uint32_t seed = 12345;
+
+    frame_pool_init(&pool, FRAME_POOL_MAX_BUFS);
+    for (int n = 0; n < 100000; n++) {
+        uint32_t r = test_rand(&seed);
+        unsigned i = (r >> 8) % FRAME_POOL_MAX_BUFS;
+        int got;
+
+        switch (r % 6) {
+        case 0:
+            got = frame_pool_capture(&pool);
+            CHECK(got < 0 || !held[got]);
+            break;
+        case 1:
+            got = frame_pool_ready(&pool);
+            CHECK(got < 0 || !held[got]);
+            break;
+        case 2:
+            if ((r >> 16) % 8 == 0)
+                frame_pool_abort(&pool);
+            break;
+        case 3:
+            got = frame_pool_get(&pool);
+            if (got >= 0) {
+                CHECK(!held[got]);
+                held[got] = 1;
+            }
+            break;
+        case 4:
+            if (held[i] >= 4)
+                break;
+            CHECK(frame_pool_ref(&pool, i) == (held[i] > 0));
+            if (held[i])
+                held[i]++;
+            break;
+        case 5:
+            CHECK(frame_pool_release(&pool, i) == (held[i] == 1));
+            if (held[i])
+                held[i]--;
+            break;
+        }
+
+        unsigned capturing = 0, ready = 0;
+        for (unsigned b = 0; b < FRAME_POOL_MAX_BUFS; b++) {
+            if (held[b])
+                CHECK(pool.state[b] == FRAME_IN_USE && pool.refs[b] == held[b]);
+            else
+                CHECK(pool.state[b] != FRAME_IN_USE);
+            capturing += pool.state[b] == FRAME_CAPTURING;
+            ready += pool.state[b] == FRAME_READY;
+        }
+        CHECK(capturing == (pool.capturing >= 0));
+        CHECK(ready <= 1);
+        if (test_failures)
+            break;
+    }
+}
+
+int main(void) {
+    shared_frame();
+    release_order(true);
+    release_order(false);
+    no_free_buffer();
+    held_not_recycled();
+    stress();
+    return test_result("test_frame_pool");
+}
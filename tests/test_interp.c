@@ -0,0 +1,94 @@
+/**
+ * yuv.c built with YUV_USE_INTERP=1 on the interpolator model, against the
+ * per-pixel reference kernels, plus a few checks of the model itself.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+
+#include "hardware/interp.h"
+#include "reference.h"
+#include "test_common.h"
+
+#define WORDS 4096
+
+static uint32_t in[WORDS], out[WORDS], ref[WORDS];
+
+// Lane arithmetic as the RP2040 datasheet describes it.
+static void test_model(void) {
+    interp_config cfg = interp_default_config();
+
+    // Shift and mask, BASE added to the result.
+    interp_config_set_shift(&cfg, 7);
+    interp_config_set_mask(&cfg, 4, 8);
+    interp_set_config(interp0, 0, &cfg);
+    interp0->base[0] = 0x1000;
+    interp0->accum[0] = 0xf800;
+    CHECK(interp0->peek[0] == 0x1000 + 0x1f0);
+
+    // Cross input: lane 1 reads ACCUM0. PEEK2 is BASE2 plus both lanes.
+    interp_config_set_cross_input(&cfg, true);
+    interp_config_set_shift(&cfg, 1);
+    interp_config_set_mask(&cfg, 4, 9);
+    interp_set_config(interp0, 1, &cfg);
+    interp0->base[1] = 0x2000;
+    interp0->base[2] = 0;
+    interp0->accum[0] = 0x07e0;
+    interp0->accum[1] = 0xffffffff;
+    CHECK(interp0->peek[1] == 0x2000 + 0x3f0);
+    CHECK(interp0->peek[2] == 0x3f0);
+
+    // Signed lane 0 of interp1 in clamp mode.
+    cfg = interp_default_config();
+    interp_config_set_shift(&cfg, 4);
+    interp_config_set_mask(&cfg, 0, 27);
+    interp_config_set_signed(&cfg, true);
+    interp_config_set_clamp(&cfg, true);
+    interp_set_config(interp1, 0, &cfg);
+    interp1->base[0] = 0;
+    interp1->base[1] = 255;
+    interp1->accum[0] = (uint32_t)-100 << 4;
+    CHECK(interp1->peek[0] == 0);
+    interp1->accum[0] = 100 << 4;
+    CHECK(interp1->peek[0] == 100);
+    interp1->accum[0] = 1000 << 4;
+    CHECK(interp1->peek[0] == 255);
+
+    // interp0 has no clamp, the same configuration just adds BASE0.
+    interp_set_config(interp0, 0, &cfg);
+    interp0->base[0] = 0;
+    interp0->accum[0] = (uint32_t)-100 << 4;
+    CHECK((int32_t)interp0->peek[0] == -100);
+}
+
+int main(void) {
+    uint32_t seed = 7;
+
+    test_model();
+
+    // Every RGB565 value in both halves of a word.
+    for (uint32_t base = 0; base < 0x10000; base += WORDS) {
+        for (int i = 0; i < WORDS; i++)
+            in[i] = (base + i) | (test_rand(&seed) & 0xffff) << 16;
+        for (int i = 1; i < WORDS; i += 2)
+            in[i] = in[i] >> 16 | in[i] << 16;
+        memcpy(out, in, sizeof(in));
+        memcpy(ref, in, sizeof(in));
+        rgb565_to_yuv422(out, WORDS);
+        ref_rgb565_to_yuv422(ref, WORDS);
+        CHECK(memcmp(out, ref, sizeof(out)) == 0);
+    }
+
+    // Every Y, U and V, with the two pixels of a word far apart.
+    for (uint32_t base = 0; base < 1u << 24; base += WORDS) {
+        for (int i = 0; i < WORDS; i++) {
+            uint32_t yuv = base + i;
+            in[i] = (yuv & 0xff) | (yuv >> 8 & 0xff) << 8 | (~yuv & 0xff) << 16 | (yuv >> 16) << 24;
+        }
+        yuv422_to_rgb565_words(in, out, WORDS);
+        ref_yuv422_to_rgb565_words(in, ref, WORDS);
+        CHECK(memcmp(out, ref, sizeof(out)) == 0);
+    }
+    return test_result("test_interp");
+}
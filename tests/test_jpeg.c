@@ -0,0 +1,131 @@
+/**
+ * jpeg_find_span() against a byte at a time search: fuzzed buffers rich in marker
+ * bytes at every alignment, truncated streams, and a benchmark on a frame buffer
+ * that is mostly empty.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "jpeg.h"
+#include "test_common.h"
+
+#define BUF_SIZE (320 * 240 * 2)
+
+static uint8_t storage[BUF_SIZE + 8] __attribute__((aligned(4)));
+
+static bool naive_find_span(const uint8_t *buf, size_t len, struct jpeg_span *span) {
+    size_t soi, eoi;
+
+    for (soi = 0; soi + 3 <= len; soi++) {
+        if (buf[soi] == 0xff && buf[soi + 1] == 0xd8 && buf[soi + 2] == 0xff)
+            break;
+    }
+    if (soi + 3 > len)
+        return false;
+    for (eoi = len - 2; eoi + 2 <= len && eoi >= soi + 2; eoi--) {
+        if (buf[eoi] == 0xff && buf[eoi + 1] == 0xd9)
+            break;
+    }
+    if (eoi + 2 > len || eoi < soi + 2)
+        return false;
+    span->soi = soi;
+    span->eoi = eoi;
+    span->len = eoi + 2 - soi;
+    return true;
+}
+
+static void check_same(const uint8_t *buf, size_t len) {
+    struct jpeg_span got = {1, 2, 3}, want = {1, 2, 3};
+    bool found = jpeg_find_span(buf, len, &got);
+
+    CHECK(found == naive_find_span(buf, len, &want));
+    CHECK(got.soi == want.soi && got.eoi == want.eoi && got.len == want.len);
+}
+
+// Mostly the bytes the search looks at, so markers overlap and straddle words.
+static void fuzz_bytes(uint8_t *buf, size_t len, uint32_t *seed) {
+    static const uint8_t pick[] = {0xff, 0xff, 0xff, 0xd8, 0xd9, 0x00, 0xfe};
+    for (size_t i = 0; i < len; i++) {
+        uint32_t r = test_rand(seed);
+        buf[i] = r & 0x100 ? pick[r % sizeof(pick)] : (uint8_t)r;
+    }
+}
+
+// SOI, entropy coded data with stuffed 0xff bytes, EOI.
+static size_t jpeg_stream(uint8_t *buf, size_t len, uint32_t *seed) {
+    size_t i = 0;
+    buf[i++] = 0xff;
+    buf[i++] = 0xd8;
+    buf[i++] = 0xff;
+    buf[i++] = 0xe0;
+    while (i < len - 4) {
+        uint8_t b = (uint8_t)test_rand(seed);
+        buf[i++] = b;
+        if (b == 0xff)
+            buf[i++] = 0x00;
+    }
+    buf[i++] = 0xff;
+    buf[i++] = 0xd9;
+    return i;
+}
+
+int main(void) {
+    uint32_t seed = 13;
+    struct jpeg_span span;
+
+    // Short buffers at every alignment, every length.
+    for (int n = 0; n < 20000; n++) {
+        size_t off = n & 3, len = test_rand(&seed) % 64;
+        fuzz_bytes(storage + off, len, &seed);
+        check_same(storage + off, len);
+    }
+    // Longer ones with few markers, so the word loops do most of the work.
+    for (int n = 0; n < 2000; n++) {
+        size_t off = n & 3, len = test_rand(&seed) % 4096;
+        for (size_t i = 0; i < len; i++)
+            storage[off + i] = (uint8_t)(test_rand(&seed) % 255);
+        for (int k = test_rand(&seed) % 4; k > 0 && len > 0; k--)
+            storage[off + test_rand(&seed) % len] = 0xff;
+        for (int k = test_rand(&seed) % 3; k > 0 && len > 1; k--) {
+            size_t at = test_rand(&seed) % (len - 1);
+            storage[off + at] = 0xff;
+            storage[off + at + 1] = test_rand(&seed) & 1 ? 0xd8 : 0xd9;
+        }
+        check_same(storage + off, len);
+    }
+    // Truncated streams: an image cut anywhere, up to the missing EOI.
+    for (int n = 0; n < 500; n++) {
+        size_t off = n & 3;
+        size_t full = jpeg_stream(storage + off, 256 + test_rand(&seed) % 2048, &seed);
+        size_t cut = test_rand(&seed) % (full + 1);
+        check_same(storage + off, cut);
+        CHECK(jpeg_find_span(storage + off, full, &span) && span.soi == 0 && span.len == full);
+        if (cut < full)
+            CHECK(!jpeg_find_span(storage + off, cut, &span) || span.eoi + 2 <= cut);
+    }
+
+    // A 20 KB image at the start of a 150 KB buffer, zeros behind it as after a
+    // VSYNC: the whole buffer, and only what the DMA wrote.
+    memset(storage, 0, sizeof(storage));
+    size_t image = jpeg_stream(storage, 20 * 1024, &seed);
+    size_t written = (image + 3) & ~(size_t)3;
+    enum { RUNS = 200 };
+    double t0, t_word = 0, t_dma = 0, t_naive = 0;
+    for (int n = 0; n < RUNS; n++) {
+        t0 = test_seconds();
+        CHECK(jpeg_find_span(storage, BUF_SIZE, &span) && span.len == image);
+        t_word += test_seconds() - t0;
+        t0 = test_seconds();
+        CHECK(jpeg_find_span(storage, written, &span) && span.len == image);
+        t_dma += test_seconds() - t0;
+        t0 = test_seconds();
+        CHECK(naive_find_span(storage, BUF_SIZE, &span) && span.len == image);
+        t_naive += test_seconds() - t0;
+    }
+    printf("20 KB JPEG in a 150 KB buffer: word scan %.2f us, DMA bounded %.2f us, byte scan %.2f us\n",
+           t_word * 1e6 / RUNS, t_dma * 1e6 / RUNS, t_naive * 1e6 / RUNS);
+    return test_result("test_jpeg");
+}
@@ -0,0 +1,104 @@
+/**
+ * The pixel and JPEG kernels of the frame path on their own: synthetic sensor
+ * frames through the kernels video_frame_send() and the LCD preview run, checked
+ * and timed per kernel. test_pipeline runs them inside the firmware.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "jpeg.h"
+#include "test_common.h"
+#include "yuv.h"
+
+#define WIDTH 320
+#define HEIGHT 240
+#define FRAMES 200
+#define WORDS (WIDTH * HEIGHT / 2)
+
+static uint32_t frame[WORDS];
+static uint32_t preview[WORDS];
+static uint8_t grey[WIDTH * HEIGHT];
+static uint8_t jpeg[WIDTH * HEIGHT * 2 / 8];
+
+// Moving colour bars, as RGB565 little endian pairs like the PIO writes them.
+static void sensor_rgb565(uint32_t *dst, int n) {
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x += 2) {
+            uint16_t p[2];
+            for (int k = 0; k < 2; k++) {
+                int v = (x + k + n * 4) & 0xff;
+                p[k] = (uint16_t)(((v >> 3) << 11) | (((y + n) & 0x3f) << 5) | ((255 - v) >> 3));
+            }
+            *dst++ = p[0] | (uint32_t)p[1] << 16;
+        }
+    }
+}
+
+// A JPEG shaped stream: SOI, scan data with stuffed 0xff 0x00 pairs, EOI, then
+// junk up to the end of the buffer like the sensor sends until VSYNC.
+static size_t sensor_jpeg(uint8_t *dst, size_t size, uint32_t *seed) {
+    size_t len = size / 2 + test_rand(seed) % (size / 4);
+    size_t i = 0;
+
+    dst[i++] = 0xff;
+    dst[i++] = 0xd8;
+    dst[i++] = 0xff;
+    while (i < len - 2) {
+        uint8_t b = (uint8_t)test_rand(seed);
+        dst[i++] = b;
+        if (b == 0xff)
+            dst[i++] = 0x00;
+    }
+    len = i;
+    dst[i++] = 0xff;
+    dst[i++] = 0xd9;
+    for (; i < size; i++)
+        dst[i] = 0x00;
+    return len + 2;
+}
+
+int main(void) {
+    double t_yuv = 0, t_rgb = 0, t_y8 = 0, t_jpeg = 0, t0;
+    uint32_t seed = 1;
+    struct jpeg_span span;
+
+    for (int n = 0; n < FRAMES; n++) {
+        sensor_rgb565(frame, n);
+
+        t0 = test_seconds();
+        rgb565_to_yuv422(frame, WORDS);
+        t_yuv += test_seconds() - t0;
+
+        t0 = test_seconds();
+        yuv422_to_rgb565_words(frame, preview, WORDS);
+        t_rgb += test_seconds() - t0;
+
+        // The preview decodes the first pair the same way as the reference.
+        if (n == 0) {
+            uint8_t rgb[2];
+            VP8YuvToRgb565(frame[0] & 0xff, (frame[0] >> 8) & 0xff, frame[0] >> 24, rgb);
+            CHECK((preview[0] & 0xffff) == (uint32_t)(rgb[0] | rgb[1] << 8));
+        }
+
+        t0 = test_seconds();
+        yuv422_to_y8(frame, grey, WORDS);
+        t_y8 += test_seconds() - t0;
+        CHECK(grey[0] == (frame[0] & 0xff));
+
+        size_t want = sensor_jpeg(jpeg, sizeof(jpeg), &seed);
+        t0 = test_seconds();
+        CHECK(jpeg_find_span(jpeg, sizeof(jpeg), &span));
+        t_jpeg += test_seconds() - t0;
+        CHECK(span.soi == 0 && span.len == want);
+    }
+
+    printf("%dx%d, %d frames:\n", WIDTH, HEIGHT, FRAMES);
+    printf("  rgb565_to_yuv422        %8.0f fps\n", FRAMES / t_yuv);
+    printf("  yuv422_to_rgb565_words  %8.0f fps\n", FRAMES / t_rgb);
+    printf("  yuv422_to_y8            %8.0f fps\n", FRAMES / t_y8);
+    printf("  jpeg_find_span          %8.0f fps\n", FRAMES / t_jpeg);
+    return test_result("test_kernels");
+}
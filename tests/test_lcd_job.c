@@ -0,0 +1,116 @@
+/**
+ * The core0/core1 LCD handoff in lcd_job.h with two threads, as main.c uses it:
+ * the producer fills a frame, posts it and converts it in place chunk by chunk
+ * behind lcd_job_wait(); the consumer pushes each chunk and publishes progress.
+ * Every chunk the consumer pushes must still hold the raw pixels of its frame,
+ * not converted ones nor those of an older frame, and every frame must be
+ * released exactly once before its buffer is filled again.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "lcd_job.h"
+#include "test_common.h"
+
+#define FRAMES 20000
+#define BUFS 2
+#define CHUNKS 8
+#define CHUNK_WORDS 16
+#define FRAME_WORDS (CHUNKS * CHUNK_WORDS)
+#define CONVERTED 0x80000000u
+
+struct frame {
+    uint32_t seq;
+    volatile uint32_t words[FRAME_WORDS];
+};
+
+static struct frame frames[BUFS], stop;
+static struct lcd_job job;
+static volatile uint32_t released[FRAMES + 1];
+static uint32_t stale, converted, reused, early;
+
+// Give the other thread a turn now and then, at varying points, so that the
+// handoffs interleave in every order even on a single CPU.
+static void maybe_yield(uint32_t *rng) {
+    *rng = *rng * 1664525u + 1013904223u;
+    if ((*rng >> 28) < 5)
+        sched_yield();
+}
+
+// The consumer, core1 in main.c, until the producer posts stop.
+static void *consumer(void *arg) {
+    uint32_t rng = 1;
+    struct frame *frame;
+
+    (void)arg;
+    while ((frame = lcd_job_take(&job)) != &stop) {
+        uint32_t seq = frame->seq;
+        for (size_t c = 0; c < CHUNKS; c++) {
+            for (size_t i = c * CHUNK_WORDS; i < (c + 1) * CHUNK_WORDS; i++) {
+                uint32_t w = frame->words[i];
+                if (w & CONVERTED)
+                    converted++;
+                else if (w != seq)
+                    stale++;
+            }
+            maybe_yield(&rng);
+            lcd_job_progress(&job, (c + 1) * CHUNK_WORDS * 4);
+        }
+        maybe_yield(&rng);
+        released[seq]++;
+        maybe_yield(&rng);
+        lcd_job_done(&job);
+    }
+    lcd_job_done(&job);
+    return NULL;
+}
+
+int main(void) {
+    pthread_t thread;
+    uint32_t rng = 2;
+
+    CHECK(pthread_create(&thread, NULL, consumer, NULL) == 0);
+
+    // The producer, core0: capture into the next buffer, show it, convert it
+    // right behind the push.
+    for (uint32_t seq = 1; seq <= FRAMES; seq++) {
+        struct frame *frame = &frames[seq % BUFS];
+        if (seq > BUFS && released[seq - BUFS] != 1)
+            reused++;
+        frame->seq = seq;
+        for (size_t i = 0; i < FRAME_WORDS; i++)
+            frame->words[i] = seq;
+
+        lcd_job_post(&job, frame);
+        for (size_t c = 0; c < CHUNKS; c++) {
+            size_t len = (c + 1) * CHUNK_WORDS * 4;
+            lcd_job_wait(&job, len);
+            if (job.frame == frame && job.pushed < len)
+                early++;
+            for (size_t i = c * CHUNK_WORDS; i < (c + 1) * CHUNK_WORDS; i++)
+                frame->words[i] = seq | CONVERTED;
+            maybe_yield(&rng);
+        }
+    }
+    lcd_job_post(&job, &stop);
+    CHECK(pthread_join(thread, NULL) == 0);
+
+    printf("%u frames, %u stale words, %u converted words pushed, %u buffers reused early\n", FRAMES,
+           (unsigned)stale, (unsigned)converted, (unsigned)reused);
+    CHECK(stale == 0);
+    CHECK(converted == 0);
+    CHECK(reused == 0);
+    CHECK(early == 0);
+    CHECK(job.frame == NULL);
+    for (uint32_t seq = 1; seq <= FRAMES; seq++) {
+        if (released[seq] != 1) {
+            printf("frame %u released %u times\n", (unsigned)seq, (unsigned)released[seq]);
+            CHECK(released[seq] == 1);
+            break;
+        }
+    }
+    return test_result("test_lcd_job");
+}
@@ -0,0 +1,131 @@
+/**
+ * ili9341_lcd.pio, run from its source on the PIO reference model, driven by the
+ * c-sdk functions in its own file through the pico-sdk model in hal_model.h: a
+ * command byte, the switch to 16-bit pulls, pixels, and back to a command and
+ * its parameter. The bits clocked out on each rising SCK edge, with the RS level
+ * at that edge, must be exactly the bytes and pixels sent, in order.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "hal_model.h"
+#include "ili9341_lcd.pio.h"
+#include "pio_model.h"
+#include "test_common.h"
+
+#define LCD_PIO pio1
+#define LCD_SM 1
+#define PIN_DOUT 11
+#define PIN_CLK 10
+
+static struct pio_model m;
+static bool rs;
+static uint32_t bits_seen, stalled_execs;
+static uint8_t bit_value[256], bit_rs[256];
+
+// SHIFTCTRL as the firmware last wrote it, read by the state machine each clock.
+static void sync_shiftctrl(void) {
+    uint32_t shiftctrl = LCD_PIO->sm[LCD_SM].shiftctrl;
+    uint thresh = (shiftctrl & PIO_SM0_SHIFTCTRL_PULL_THRESH_BITS) >> PIO_SM0_SHIFTCTRL_PULL_THRESH_LSB;
+    m.autopull = shiftctrl & PIO_SM0_SHIFTCTRL_AUTOPULL_BITS;
+    m.out_shift_right = shiftctrl & PIO_SM0_SHIFTCTRL_OUT_SHIFTDIR_BITS;
+    m.pull_threshold = thresh ? (int)thresh : 32;
+}
+
+static void lcd_exec(PIO pio, uint sm, uint instr) {
+    if (pio != LCD_PIO || sm != LCD_SM)
+        return;
+    sync_shiftctrl();
+    if (!pio_model_exec(&m, pio_model_decode(&m, (uint16_t)instr)))
+        stalled_execs++;
+}
+
+// Run the state machine until it stalls with nothing left to pull, recording
+// the data bit and RS on every rising clock edge.
+static void lcd_drain(void) {
+    for (int i = 0; i < 10000; i++) {
+        int side = m.side;
+        sync_shiftctrl();
+        if (!hal.sm[pio_get_index(LCD_PIO)][LCD_SM].enabled || !pio_model_step(&m, 0))
+            return;
+        if (side == 0 && m.side == 1 && bits_seen < sizeof(bit_value)) {
+            bit_value[bits_seen] = m.pins & 1;
+            bit_rs[bits_seen++] = rs;
+        }
+    }
+    CHECK(!"state machine never stalled");
+}
+
+// ili9341_lcd_put(), with the narrow store replicated across the FIFO word.
+static void lcd_put8(uint8_t x) {
+    ili9341_lcd_put(LCD_PIO, LCD_SM, x);
+    CHECK(pio_model_put(&m, x * 0x01010101u));
+}
+
+// A 16-bit DMA write of one pixel, replicated the same way.
+static void lcd_put16(uint16_t pixel) {
+    CHECK(pio_model_put(&m, pixel * 0x00010001u));
+}
+
+// As lcd_send_cmd() does: drain, RS low for the command byte, RS high after.
+static void lcd_cmd(uint8_t cmd) {
+    lcd_drain();
+    ili9341_lcd_wait_idle(LCD_PIO, LCD_SM);
+    rs = false;
+    lcd_put8(cmd);
+    lcd_drain();
+    rs = true;
+}
+
+// The bits recorded from *pos on are value, MSB first, clocked with RS at level.
+static bool clocked(uint32_t *pos, uint32_t value, int bits, bool level) {
+    bool ok = *pos + bits <= bits_seen;
+    for (int i = bits - 1; ok && i >= 0; i--, (*pos)++)
+        ok = bit_value[*pos] == ((value >> i) & 1) && bit_rs[*pos] == level;
+    return ok;
+}
+
+int main(void) {
+    static const uint16_t pixels[] = {0xf800, 0x07e0, 0x001f, 0xa55a};
+    uint32_t pos = 0;
+
+    hal_reset();
+    hal.on_exec = lcd_exec;
+    pio_model_load(&m, ILI9341_LCD_PIO, "ili9341_lcd");
+
+    // The stand-in header assembles the same program.
+    CHECK(ili9341_lcd_program.length == m.length);
+    CHECK(ili9341_lcd_wrap_target == m.wrap_target && ili9341_lcd_wrap == m.wrap);
+    for (int i = 0; i < m.length; i++) {
+        struct pio_instr in = pio_model_decode(&m, ili9341_lcd_program_instructions[i]);
+        CHECK(in.op == m.prog[i].op && in.side == m.prog[i].side);
+    }
+
+    uint offset = pio_add_program(LCD_PIO, &ili9341_lcd_program);
+    CHECK(offset == 0); // model pc == program offset
+    ili9341_lcd_program_init(LCD_PIO, LCD_SM, offset, PIN_DOUT, PIN_CLK, 62.5e6f);
+    rs = true;
+
+    // RAMWR, then pixels at 16 bits a pull.
+    lcd_cmd(0x2c);
+    ili9341_lcd_set_pull_bits(LCD_PIO, LCD_SM, 16);
+    for (size_t i = 0; i < count_of(pixels); i++)
+        lcd_put16(pixels[i]);
+    lcd_drain();
+
+    // Back to bytes: CASET and its first parameter.
+    ili9341_lcd_set_pull_bits(LCD_PIO, LCD_SM, 8);
+    lcd_cmd(0x2a);
+    lcd_put8(0x12);
+    lcd_drain();
+
+    CHECK(stalled_execs == 0);
+    CHECK(clocked(&pos, 0x2c, 8, false));
+    for (size_t i = 0; i < count_of(pixels); i++)
+        CHECK(clocked(&pos, pixels[i], 16, true));
+    CHECK(clocked(&pos, 0x2a, 8, false));
+    CHECK(clocked(&pos, 0x12, 8, true));
+    printf("%u bits clocked, %u expected\n", (unsigned)bits_seen, (unsigned)pos);
+    CHECK(bits_seen == pos);
+    return test_result("test_lcd_pio");
+}
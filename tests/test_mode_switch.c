@@ -0,0 +1,183 @@
+/**
+ * video_mode_update() on the host, see sim_firmware.h: the host streams and
+ * commits new formats and frame sizes while a frame is in flight on the stream,
+ * while the LCD DMA is pushing one, and twice in a row. Every frame received must
+ * be a whole frame of either the mode streamed so far or the one committed last,
+ * and once the new mode shows up the old one never comes back. The camera's state
+ * machine is only reinitialised with no transfer in flight and the LCD idle, and
+ * only when the sensor mode changes.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "sim_firmware.h"
+#include "test_common.h"
+#include "yuv.h"
+
+#define STREAM_START_US 500000
+#define SETTLED_FRAMES 3 // of a mode before the next commit
+
+struct mode {
+    unsigned format, frame; // format 0: none
+};
+
+enum phase {
+    PHASE_START,       // YUY2 320x240
+    PHASE_MID_XFER,    // size change with a transfer in flight
+    PHASE_CONVERSION,  // format change in the same sensor mode
+    PHASE_OVERWRITTEN, // two commits before the first is applied
+    PHASE_RAW,         // RGBP, sensor mode unchanged
+    PHASE_MID_LCD,     // size change with the LCD DMA pushing
+    PHASE_MID_LCD_FMT, // sensor format change with the LCD DMA pushing
+    PHASE_DONE,
+};
+
+static struct mode cur, next; // streamed, committed but not seen yet
+static enum phase phase;
+static uint32_t mode_frames; // of cur since it showed up
+static uint32_t bad, inits, inits_busy;
+
+static uint8_t expected[FRAME_BYTES] __attribute__((aligned(4)));
+static uint8_t scratch[YUV420_SCRATCH_SIZE(FRAME_WIDTH, FRAME_HEIGHT)] __attribute__((aligned(4)));
+
+static bool frame_size(unsigned frame, uint *width, uint *height) {
+#define FRAME_SIZE(_frmidx, _width, _height, _fps) \
+    if (frame == (_frmidx)) {                      \
+        *width = _width;                           \
+        *height = _height;                         \
+        return true;                               \
+    }
+    UVC_FRAME_SIZES(FRAME_SIZE)
+#undef FRAME_SIZE
+    return false;
+}
+
+// Whether buf is frame seq as the firmware sends it in mode m.
+static bool frame_is(struct mode m, const uint8_t *buf, size_t size, uint32_t seq, uint width, uint height) {
+    uint w, h;
+    if (!m.format || !frame_size(m.frame, &w, &h) || width != w || height != h)
+        return false;
+
+    size_t bytes = (size_t)w * h * 2;
+    sensor_frame(seq, expected, w, h);
+    switch (m.format) {
+    case UVC_FORMAT_YUY2:
+        rgb565_to_yuv422((uint32_t *)expected, (int)(bytes / 4));
+        break;
+    case UVC_FORMAT_NV12:
+    case UVC_FORMAT_I420: {
+        enum yuv420_layout layout = m.format == UVC_FORMAT_NV12 ? YUV420_NV12 : YUV420_I420;
+        for (uint pair = 0; pair < h / 2; pair++)
+            yuv420_pack_rows(expected, (int)w, (int)pair, layout, true, scratch);
+        yuv420_planarize(expected, (int)w, (int)h, layout, scratch);
+        bytes = bytes / 4 * 3;
+        break;
+    }
+    case UVC_FORMAT_GREY:
+        yuv422_to_y8((const uint32_t *)expected, expected, (int)(bytes / 4));
+        bytes /= 2;
+        break;
+    default: // RGBP goes out as captured
+        break;
+    }
+    return size == bytes && memcmp(buf, expected, bytes) == 0;
+}
+
+static void check_frame(const uint8_t *buf, size_t size, uint32_t seq, uint width, uint height) {
+    if (frame_is(next, buf, size, seq, width, height)) {
+        cur = next;
+        next.format = 0;
+        mode_frames = 1;
+    } else if (frame_is(cur, buf, size, seq, width, height)) {
+        mode_frames++;
+    } else {
+        bad++;
+        printf("frame %u: %ux%u, %zu bytes, neither format %u frame %u nor format %u frame %u\n",
+               (unsigned)seq, width, height, size, cur.format, cur.frame, next.format, next.frame);
+    }
+}
+
+static void commit(unsigned format, unsigned frame) {
+    sim_commit(format, frame);
+    next = (struct mode){format, frame};
+}
+
+// The host's side, every simulated us: the next commit once the current mode
+// has been streamed for a while, some of them only at the moment they test.
+static void host_phases(void) {
+    bool settled = !next.format && mode_frames >= SETTLED_FRAMES;
+
+    switch (phase) {
+    case PHASE_START:
+        if (hal.now_us < STREAM_START_US)
+            return;
+        commit(UVC_FORMAT_YUY2, 1);
+        break;
+    case PHASE_MID_XFER:
+        if (!settled || !host.busy)
+            return;
+        commit(UVC_FORMAT_YUY2, 3);
+        break;
+    case PHASE_CONVERSION:
+        if (!settled)
+            return;
+        commit(UVC_FORMAT_NV12, 3);
+        break;
+    case PHASE_OVERWRITTEN:
+        if (!settled)
+            return;
+        // NV12 320x240 must never be streamed.
+        commit(UVC_FORMAT_NV12, 1);
+        commit(UVC_FORMAT_I420, 2);
+        break;
+    case PHASE_RAW:
+        if (!settled)
+            return;
+        commit(UVC_FORMAT_RGBP, 2);
+        break;
+    case PHASE_MID_LCD:
+        if (!settled || !sim_lcd_busy())
+            return;
+        commit(UVC_FORMAT_RGBP, 1);
+        break;
+    case PHASE_MID_LCD_FMT:
+        if (!settled || !sim_lcd_busy())
+            return;
+        commit(UVC_FORMAT_GREY, 3);
+        break;
+    case PHASE_DONE:
+        return;
+    }
+    phase++;
+}
+
+static void sensor_init(void) {
+    if (!host.streaming)
+        return; // boot
+    inits++;
+    if (host.busy || sim_lcd_busy())
+        inits_busy++;
+}
+
+int main(void) {
+    sim.end_us = 6000000;
+    sim.advance = host_phases;
+    sim.xfer = check_frame;
+    sim.sensor_init = sensor_init;
+
+    sim_run();
+
+    printf("host %u frames, %u of format %u frame %u after the last switch; %u sensor inits\n",
+           (unsigned)host.frames, (unsigned)mode_frames, cur.format, cur.frame, (unsigned)inits);
+
+    CHECK(phase == PHASE_DONE);
+    CHECK(cur.format == UVC_FORMAT_GREY && cur.frame == 3);
+    CHECK(!next.format && mode_frames >= SETTLED_FRAMES);
+    CHECK(bad == 0);
+    // 320x240 -> 160x120, -> 176x144, -> 320x240, RGB565 -> GRAYSCALE 160x120.
+    CHECK(inits == 4);
+    CHECK(inits_busy == 0);
+    CHECK(host.changed == 0);
+    CHECK(lcd.bad == 0);
+    return test_result("test_mode_switch");
+}
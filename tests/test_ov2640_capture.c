@@ -0,0 +1,151 @@
+/**
+ * Frame buffer rotation of ov2640.c on the pico-sdk model in hal_model.h, with the
+ * capture DMA written and the end of frame IRQ raised by hand: a frame completes
+ * into the buffer the DMA was armed with, the DMA moves on to a free buffer, the
+ * state machine is parked when none is free and re-armed by the release that
+ * frees one. Also the newest frame replacing one nobody took, and truncation.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "hal_model.h"
+#include "ov2640.h"
+#include "test_common.h"
+
+#define WIDTH 16
+#define HEIGHT 4
+#define FRAME_BYTES (WIDTH * HEIGHT * 2)
+#define PIN_VSYNC 3
+#define CAM_DMA 0
+#define CAM_SM 0
+
+static uint8_t bufs[2][FRAME_BYTES] __attribute__((aligned(4)));
+static uint8_t pixels[FRAME_BYTES];
+static unsigned ready_calls;
+
+static void frame_ready(struct ov2640_config *config) {
+    (void)config;
+    ready_calls++;
+}
+
+static struct ov2640_config config = {
+    .sccb = i2c0,
+    .pin_resetb = 2,
+    .pin_vsync = PIN_VSYNC,
+    .pin_y2_pio_base = 6,
+    .pio = pio0,
+    .pio_sm = CAM_SM,
+    .dma_channel = CAM_DMA,
+    .frame_width = WIDTH,
+    .frame_height = HEIGHT,
+    .image_bufs = {bufs[0], bufs[1]},
+    .image_buf_count = 2,
+    .image_buf_size = FRAME_BYTES,
+    .pixformat = PIXFORMAT_RGB565,
+    .frame_ready_cb = frame_ready,
+};
+
+static bool sm_enabled(void) {
+    return hal.sm[0][CAM_SM].enabled;
+}
+
+// Armed on buf: the DMA waits for a whole frame there and the SM runs.
+static bool armed_on(const uint8_t *buf) {
+    return sm_enabled() && dma_channel_is_busy(CAM_DMA) && hal.dma[CAM_DMA].write_addr == (uintptr_t)buf &&
+           hal.dma[CAM_DMA].hw.transfer_count == FRAME_BYTES / 4;
+}
+
+// The sensor sends bytes of a frame starting at a VSYNC edge, then image.pio
+// raises its end of frame IRQ.
+static void sensor_frame(uint8_t fill, size_t bytes) {
+    memset(pixels, fill, sizeof(pixels));
+    hal_advance(1000);
+    hal_gpio_edge(PIN_VSYNC, GPIO_IRQ_EDGE_RISE);
+    hal_advance(1000);
+    hal_dma_write(CAM_DMA, pixels, bytes);
+    hal_pio_irq(pio0, CAM_SM);
+}
+
+static bool holds(const struct ov2640_frame *frame, const uint8_t *buf, uint8_t fill) {
+    for (size_t i = 0; i < FRAME_BYTES; i++) {
+        if (buf[i] != fill)
+            return false;
+    }
+    return frame && frame->buf == buf;
+}
+
+int main(void) {
+    struct ov2640_frame *a, *b, *c;
+    uint32_t vsync_us;
+
+    hal_reset();
+    ov2640_init(&config);
+    irq_set_enabled(PIO0_IRQ_0, true);
+    CHECK(!sm_enabled());
+    CHECK(ov2640_capture_get_frame(&config) == NULL);
+
+    // Started: the DMA waits at the first buffer.
+    ov2640_capture_start(&config);
+    CHECK(armed_on(bufs[0]));
+
+    // A frame completes into it, the DMA moves on to the second one.
+    sensor_frame(0x11, FRAME_BYTES);
+    vsync_us = time_us_32() - 1000;
+    CHECK(ready_calls == 1);
+    CHECK(armed_on(bufs[1]));
+    a = ov2640_capture_get_frame(&config);
+    CHECK(holds(a, bufs[0], 0x11));
+    CHECK(a && a->len == FRAME_BYTES && a->lines == HEIGHT);
+    CHECK(a && a->vsync_us == vsync_us);
+    CHECK(ov2640_capture_get_frame(&config) == NULL);
+
+    // The second frame completes while the first is held: nothing is free, so
+    // the state machine is parked instead of stalling into a frame.
+    sensor_frame(0x22, FRAME_BYTES);
+    CHECK(ready_calls == 2);
+    CHECK(!sm_enabled());
+    CHECK(!dma_channel_is_busy(CAM_DMA));
+    // A frame the sensor sends meanwhile goes nowhere.
+    sensor_frame(0x33, FRAME_BYTES);
+    CHECK(ready_calls == 2);
+    CHECK(holds(a, bufs[0], 0x11));
+
+    // Releasing the first frame frees its buffer and re-arms the capture there.
+    ov2640_capture_release_frame(&config, a);
+    CHECK(armed_on(bufs[0]));
+
+    // The next frame lands in it. The second one was never taken, the newer one
+    // replaces it and its buffer is armed next.
+    sensor_frame(0x44, FRAME_BYTES);
+    CHECK(ready_calls == 3);
+    CHECK(armed_on(bufs[1]));
+    b = ov2640_capture_get_frame(&config);
+    CHECK(holds(b, bufs[0], 0x44));
+    CHECK(ov2640_capture_get_frame(&config) == NULL);
+
+    // A second reference keeps the buffer until both are released.
+    ov2640_capture_ref_frame(&config, b);
+    sensor_frame(0x55, FRAME_BYTES);
+    CHECK(!sm_enabled());
+    ov2640_capture_release_frame(&config, b);
+    CHECK(!sm_enabled());
+    ov2640_capture_release_frame(&config, b);
+    CHECK(armed_on(bufs[0]));
+
+    // A frame cut short still completes, as truncated.
+    c = ov2640_capture_get_frame(&config);
+    CHECK(holds(c, bufs[1], 0x55));
+    ov2640_capture_release_frame(&config, c);
+    sensor_frame(0x66, FRAME_BYTES / 2);
+    c = ov2640_capture_get_frame(&config);
+    CHECK(c && c->buf == bufs[0] && c->len == FRAME_BYTES / 2 && c->lines == HEIGHT / 2);
+    ov2640_capture_release_frame(&config, c);
+
+    // Stopping frees the buffer being captured and parks the state machine.
+    ov2640_capture_stop(&config);
+    CHECK(!sm_enabled());
+    CHECK(!dma_channel_is_busy(CAM_DMA));
+    ov2640_capture_start(&config);
+    CHECK(sm_enabled() && dma_channel_is_busy(CAM_DMA));
+    return test_result("test_ov2640_capture");
+}
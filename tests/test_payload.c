@@ -0,0 +1,79 @@
+/**
+ * UVC payload framing of the bulk build: each frame size at the fastest interval
+ * its descriptor offers, split into payloads the way tinyusb does, with a 2 byte
+ * header per payload and 64 byte packets per transfer.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "test_common.h"
+#include "tusb.h"
+#include "usb_descriptors.h"
+
+#define VS_HEADER_SIZE 2
+#define BULK_PACKET_SIZE 64
+
+struct framing {
+    unsigned payload;  // dwMaxPayloadTransferSize
+    unsigned payloads; // transfers per frame
+    unsigned packets;  // bulk packets per frame
+    double efficiency; // frame bytes over frame and header bytes
+    double fill;       // frame bytes over full packets
+};
+
+// tinyusb commits the smaller of the endpoint buffer and the frame bytes per ms of
+// frame interval, plus the header, and fills every payload but the last.
+static struct framing frame_framing(unsigned bytes, uint32_t interval, unsigned bufsize) {
+    struct framing f = {0};
+    unsigned interval_ms = interval / 10000, left;
+
+    f.payload = (bytes + interval_ms - 1) / interval_ms + VS_HEADER_SIZE;
+    if (f.payload > bufsize)
+        f.payload = bufsize;
+    for (left = bytes; left;) {
+        unsigned n = left < f.payload - VS_HEADER_SIZE ? left : f.payload - VS_HEADER_SIZE;
+        f.payloads++;
+        f.packets += (n + VS_HEADER_SIZE + BULK_PACKET_SIZE - 1) / BULK_PACKET_SIZE;
+        left -= n;
+    }
+    f.efficiency = (double)bytes / (bytes + f.payloads * VS_HEADER_SIZE);
+    f.fill = (double)bytes / (f.packets * BULK_PACKET_SIZE);
+    return f;
+}
+
+static void check_frame(const char *name, unsigned width, unsigned height, unsigned bytes, uint32_t interval) {
+    struct framing f = frame_framing(bytes, interval, CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE);
+    struct framing small = frame_framing(bytes, interval, 256);
+
+    printf("%-5s %3ux%-3u %5.2f fps: %4u byte payloads, %3u per frame, %5.2f%% framing, %5.2f%% packet fill"
+           " (256 byte buffer: %3u per frame, %5.2f%%)\n",
+           name, width, height, 1e7 / interval, f.payload, f.payloads, 100 * f.efficiency, 100 * f.fill,
+           small.payloads, 100 * small.efficiency);
+    CHECK(f.payload <= CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE);
+    CHECK(f.efficiency > 0.99);
+    CHECK(f.payloads <= small.payloads);
+    // The frame rate offered has to fit in the 19 packets of a full speed frame.
+    CHECK((uint64_t)f.packets * 10000 <= 19ULL * interval);
+}
+
+#define CHECK_RAW(_frmidx, _width, _height, _fps) \
+    check_frame("YUY2", _width, _height, _width * _height * 2, UVC_INTERVAL(_width * _height * 2, _fps)); \
+    check_frame("GREY", _width, _height, _width * _height, UVC_INTERVAL(_width * _height, _fps)); \
+    check_frame("NV12", _width, _height, _width * _height * 3 / 2, UVC_INTERVAL(_width * _height * 3 / 2, _fps));
+#define CHECK_MJPEG(_frmidx, _width, _height, _fps) \
+    check_frame("MJPEG", _width, _height, UVC_MJPEG_BYTES(_width, _height), \
+                UVC_INTERVAL(UVC_MJPEG_BYTES(_width, _height), _fps));
+
+int main(void) {
+    struct framing full = frame_framing(1 << 20, 10000, CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE);
+
+    CHECK(CFG_TUD_VIDEO_STREAMING_BULK);
+    // A full payload is whole packets with one header.
+    CHECK(full.payload == CFG_TUD_VIDEO_STREAMING_BULK_PAYLOAD);
+    CHECK(full.payload % BULK_PACKET_SIZE == 0);
+    CHECK(full.efficiency > 0.999);
+
+    UVC_FRAME_SIZES(CHECK_RAW)
+    UVC_MJPEG_FRAME_SIZES(CHECK_MJPEG)
+    return test_result("test_payload");
+}
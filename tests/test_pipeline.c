@@ -0,0 +1,64 @@
+/**
+ * The firmware's frame path on the host, see sim_firmware.h: the host commits
+ * QVGA YUY2 and streams for a few seconds. The frames it receives are checked
+ * against rgb565_to_yuv422() of what the sensor sent, the LCD against the
+ * sensor's pixels before their conversion.
+ *
+ * The simulated frame rate counts I/O time only, the host time per frame is
+ * printed too.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "sim_firmware.h"
+#include "test_common.h"
+#include "yuv.h"
+
+#define STREAM_START_US 1000000
+#define STREAM_US 4000000
+
+static uint8_t expected[FRAME_BYTES] __attribute__((aligned(4)));
+static uint32_t bad;
+
+static void stream_start(void) {
+    if (!host.streaming && hal.now_us >= STREAM_START_US)
+        sim_commit(UVC_FORMAT_YUY2, 1);
+}
+
+static void check_yuy2(const uint8_t *buf, size_t size, uint32_t seq, uint width, uint height) {
+    CHECK(size == FRAME_BYTES && width == FRAME_WIDTH && height == FRAME_HEIGHT);
+    sensor_frame(seq, expected, FRAME_WIDTH, FRAME_HEIGHT);
+    rgb565_to_yuv422((uint32_t *)expected, FRAME_BYTES / 4);
+    if (size != FRAME_BYTES || memcmp(buf, expected, FRAME_BYTES) != 0)
+        bad++;
+}
+
+int main(void) {
+    double t0;
+
+    sim.end_us = STREAM_START_US + STREAM_US;
+    sim.tick = stream_start;
+    sim.xfer = check_yuy2;
+
+    t0 = test_seconds();
+    sim_run();
+    t0 = test_seconds() - t0;
+
+    double sim_s = (host.last_us - host.first_us) / 1e6;
+    double bw_fps = (double)UVC_STREAM_BYTES_PER_SEC / FRAME_BYTES;
+    printf("sensor %u frames, %u captured; lcd %llu bytes; host %u frames\n", (unsigned)sensor.frames,
+           (unsigned)sensor.captured, (unsigned long long)lcd.bytes, (unsigned)host.frames);
+    printf("320x240 yuy2: %.2f fps simulated (stream bandwidth allows %.2f), %.0f us/frame on this host\n",
+           host.frames / sim_s, bw_fps, t0 * 1e6 / MAX(host.frames, 1));
+
+    CHECK(host.frames >= 10);
+    CHECK(bad == 0);
+    CHECK(host.changed == 0);
+    CHECK(lcd.bad == 0);
+    // Every frame sent went to the LCD first.
+    CHECK(lcd.bytes >= (uint64_t)host.frames * FRAME_BYTES);
+    // Capture overlaps the transfer of the frame before it only with a second
+    // buffer, so one frame takes about a transfer plus a sensor period or two.
+    CHECK(host.frames / sim_s > bw_fps / 2);
+    return test_result("test_pipeline");
+}
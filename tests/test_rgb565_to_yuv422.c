@@ -0,0 +1,93 @@
+/**
+ * rgb565_to_yuv422() against the per-pixel fixed-point kernel it replaced: every
+ * RGB565 value in both halves of a word, random pairs, and a QVGA benchmark. Also
+ * against full range BT.601 (JFIF) in floating point.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "reference.h"
+#include "test_common.h"
+
+#define WORDS (320 * 240 / 2)
+#define FRAMES 100
+
+static uint32_t in[WORDS], out[WORDS], ref[WORDS];
+
+// Largest difference of Y, U or V from the floating point conversion, with U and
+// V averaged over the pair.
+static double float_error(const uint32_t *rgb, const uint32_t *yuv, int len) {
+    double err = 0;
+
+    for (int i = 0; i < len; i++) {
+        uint8_t p[2][3];
+        double u = 128, v = 128;
+
+        color16to24(rgb[i] & 0xffff, p[0]);
+        color16to24(rgb[i] >> 16, p[1]);
+        for (int k = 0; k < 2; k++) {
+            double y = 0.299 * p[k][0] + 0.587 * p[k][1] + 0.114 * p[k][2];
+            err = fmax(err, fabs(((yuv[i] >> (16 * k)) & 0xff) - y));
+            u += (-0.168736 * p[k][0] - 0.331264 * p[k][1] + 0.5 * p[k][2]) / 2;
+            v += (0.5 * p[k][0] - 0.418688 * p[k][1] - 0.081312 * p[k][2]) / 2;
+        }
+        err = fmax(err, fabs(((yuv[i] >> 8) & 0xff) - fmin(u, 255)));
+        err = fmax(err, fabs((yuv[i] >> 24) - fmin(v, 255)));
+    }
+    return err;
+}
+
+static int compare(int len) {
+    memcpy(out, in, (size_t)len * 4);
+    memcpy(ref, in, (size_t)len * 4);
+    rgb565_to_yuv422(out, len);
+    ref_rgb565_to_yuv422(ref, len);
+    return memcmp(out, ref, (size_t)len * 4);
+}
+
+int main(void) {
+    uint32_t seed = 6;
+    double t0, t_lut, t_ref;
+
+    // Every value as the first and as the second pixel, paired with a random one.
+    for (uint32_t base = 0; base < 0x10000; base += WORDS / 2) {
+        for (int i = 0; i < WORDS / 2; i++) {
+            uint32_t a = (base + i) & 0xffff, b = test_rand(&seed) & 0xffff;
+            in[2 * i] = a | b << 16;
+            in[2 * i + 1] = b | a << 16;
+        }
+        CHECK(compare(WORDS) == 0);
+    }
+    // The extremes, where U and V clip.
+    static const uint16_t edge[] = {0x0000, 0xffff, 0xf800, 0x07e0, 0x001f, 0xffe0, 0xf81f, 0x07ff};
+    for (int i = 0; i < 8; i++) {
+        for (int j = 0; j < 8; j++)
+            in[i * 8 + j] = edge[i] | (uint32_t)edge[j] << 16;
+    }
+    CHECK(compare(64) == 0);
+    CHECK(float_error(in, out, 64) <= 1.0);
+
+    for (int i = 0; i < WORDS; i++)
+        in[i] = test_rand(&seed);
+    t0 = test_seconds();
+    for (int n = 0; n < FRAMES; n++) {
+        memcpy(out, in, sizeof(in));
+        rgb565_to_yuv422(out, WORDS);
+    }
+    t_lut = test_seconds() - t0;
+    t0 = test_seconds();
+    for (int n = 0; n < FRAMES; n++) {
+        memcpy(ref, in, sizeof(in));
+        ref_rgb565_to_yuv422(ref, WORDS);
+    }
+    t_ref = test_seconds() - t0;
+    CHECK(memcmp(out, ref, sizeof(out)) == 0);
+    CHECK(float_error(in, out, WORDS) <= 1.0);
+
+    printf("320x240 rgb565_to_yuv422: %.1f us/frame, per-pixel reference %.1f us/frame (%.2fx)\n",
+           t_lut * 1e6 / FRAMES, t_ref * 1e6 / FRAMES, t_ref / t_lut);
+    return test_result("test_rgb565_to_yuv422");
+}
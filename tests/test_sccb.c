@@ -0,0 +1,196 @@
+/**
+ * The SCCB register shadow in ov2640.c, against a model of the OV2640's two
+ * register banks behind a stub i2c_write_blocking(). Every mode change is also
+ * replayed register by register, without the shadow, on a second model: the
+ * sensor must end up in the same state with fewer bus transactions, the DSP's
+ * action registers must still be written every time, and a soft reset must
+ * invalidate the shadow, so the next init costs as many writes as the first.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "hal_model.h"
+#include "ov2640.h"
+#include "ov2640_init.h"
+#include "test_common.h"
+
+#define WIDTH 320
+#define HEIGHT 240
+
+struct sensor {
+    uint8_t regs[2][256];
+    int bank;
+    uint8_t read_reg;
+    uint32_t writes;  // register writes, BANK_SEL included
+    uint32_t actions; // writes to the DSP's RESET and MC_BIST
+    uint32_t others;  // writes that are neither BANK_SEL nor actions
+};
+
+static struct sensor sensor, ref;
+static uint8_t frame_buf[WIDTH * HEIGHT * 2] __attribute__((aligned(4)));
+
+// Power-on state, and the registers after a soft reset.
+static void sensor_reset(struct sensor *s) {
+    for (int b = 0; b < 2; b++) {
+        for (int r = 0; r < 256; r++)
+            s->regs[b][r] = (uint8_t)(r * 7 + b * 3 + 1);
+    }
+    s->regs[BANK_SEL_SENS][MIDH] = 0x7f;
+    s->regs[BANK_SEL_SENS][MIDL] = 0xa2;
+    s->regs[BANK_SEL_SENS][REG_PID] = 0x26;
+    s->regs[BANK_SEL_SENS][REG_VER] = 0x42;
+    s->bank = BANK_SEL_DSP;
+}
+
+static void sensor_write(struct sensor *s, uint8_t reg, uint8_t value) {
+    s->writes++;
+    if (reg == BANK_SEL) {
+        s->bank = value & 1;
+        return;
+    }
+    if (s->bank == BANK_SEL_DSP && (reg == RESET || reg == MC_BIST))
+        s->actions++;
+    else
+        s->others++;
+    s->regs[s->bank][reg] = value;
+    // BANK_SEL survives a soft reset, the probe reads the IDs right after it.
+    if (s->bank == BANK_SEL_SENS && reg == COM7 && (value & COM7_SRST)) {
+        sensor_reset(s);
+        s->bank = BANK_SEL_SENS;
+    }
+}
+
+static int sccb_write(uint8_t addr, const uint8_t *src, size_t len) {
+    CHECK(addr == 0x30);
+    if (len == 2)
+        sensor_write(&sensor, src[0], src[1]);
+    else if (len == 1)
+        sensor.read_reg = src[0];
+    else
+        CHECK(!"SCCB write of more than one register");
+    return (int)len;
+}
+
+static int sccb_read(uint8_t addr, uint8_t *dst, size_t len) {
+    CHECK(addr == 0x30 && len == 1);
+    dst[0] = sensor.regs[sensor.bank][sensor.read_reg];
+    return (int)len;
+}
+
+// ov2640.c's tables, written one by one to the reference.
+static void ref_table(const OV2640_command *cmd) {
+    for (; !(cmd->reg == 0xff && cmd->value == 0xff); cmd++)
+        sensor_write(&ref, cmd->reg, cmd->value);
+}
+
+// The registers ov2640_write_mode() writes for a mode.
+static void ref_mode(pixformat_t pixformat, uint width, uint height) {
+    const struct ov2640_win_size *win = &ov2640_supported_win_sizes[count_of(ov2640_supported_win_sizes) - 1];
+    for (size_t i = 0; i < count_of(ov2640_supported_win_sizes); i++) {
+        if (ov2640_supported_win_sizes[i].width >= width && ov2640_supported_win_sizes[i].height >= height) {
+            win = &ov2640_supported_win_sizes[i];
+            break;
+        }
+    }
+    ref_table(ov2640_size_change_preamble_regs);
+    ref_table(win->regs);
+    ref_table(ov2640_format_change_preamble_regs);
+    ref_table(pixformat == PIXFORMAT_RGB565 ? ov2640_rgb565_be_regs
+              : pixformat == PIXFORMAT_JPEG ? ov2640_settings_jpeg
+                                            : ov2640_uyvy_regs);
+}
+
+// The probe's soft reset, then the init table and the mode.
+static void ref_init(pixformat_t pixformat, uint width, uint height) {
+    sensor_write(&ref, BANK_SEL, BANK_SEL_SENS);
+    sensor_write(&ref, COM7, COM7_SRST);
+    ref_table(ov2640_init_regs);
+    ref_mode(pixformat, width, height);
+}
+
+static struct ov2640_config config = {
+    .sccb = i2c0,
+    .pin_resetb = 2,
+    .pin_vsync = 3,
+    .pin_y2_pio_base = 6,
+    .pio = pio0,
+    .pio_sm = 0,
+    .dma_channel = 0,
+    .frame_width = WIDTH,
+    .frame_height = HEIGHT,
+    .image_bufs = {frame_buf},
+    .image_buf_count = 1,
+    .image_buf_size = sizeof(frame_buf),
+    .pixformat = PIXFORMAT_RGB565,
+};
+
+static void bus_reset(void) {
+    hal_reset();
+    hal.i2c_write = sccb_write;
+    hal.i2c_read = sccb_read;
+}
+
+static bool same_state(void) {
+    return sensor.bank == ref.bank && !memcmp(sensor.regs, ref.regs, sizeof(sensor.regs));
+}
+
+// Counters of both models from here on.
+static void counters_clear(void) {
+    sensor.writes = sensor.actions = sensor.others = 0;
+    ref.writes = ref.actions = ref.others = 0;
+}
+
+int main(void) {
+    uint32_t init_writes;
+
+    sensor_reset(&sensor);
+    sensor_reset(&ref);
+
+    // Power on: everything in the tables that changes a register goes out.
+    bus_reset();
+    ov2640_init(&config);
+    ref_init(PIXFORMAT_RGB565, WIDTH, HEIGHT);
+    CHECK(same_state());
+    printf("init: %u writes, %u without the shadow\n", (unsigned)sensor.writes, (unsigned)ref.writes);
+    CHECK(sensor.writes < ref.writes);
+    init_writes = sensor.writes;
+
+    // A format change only writes what differs, and every action.
+    counters_clear();
+    ov2640_set_mode(&config, PIXFORMAT_YUV422, WIDTH, HEIGHT);
+    ref_mode(PIXFORMAT_YUV422, WIDTH, HEIGHT);
+    CHECK(same_state());
+    printf("yuv422: %u writes, %u without the shadow\n", (unsigned)sensor.writes, (unsigned)ref.writes);
+    CHECK(sensor.writes < ref.writes);
+    CHECK(sensor.actions == ref.actions && ref.actions > 0);
+
+    // The same mode again: nothing but bank switches and actions.
+    counters_clear();
+    ov2640_set_mode(&config, PIXFORMAT_YUV422, WIDTH, HEIGHT);
+    ref_mode(PIXFORMAT_YUV422, WIDTH, HEIGHT);
+    CHECK(same_state());
+    CHECK(sensor.others == 0);
+    CHECK(sensor.actions == ref.actions);
+
+    // Size and format at once, then back: the banks keep their own registers.
+    counters_clear();
+    ov2640_set_mode(&config, PIXFORMAT_RGB565, 160, 120);
+    ref_mode(PIXFORMAT_RGB565, 160, 120);
+    CHECK(same_state());
+    ov2640_set_mode(&config, PIXFORMAT_YUV422, WIDTH, HEIGHT);
+    ref_mode(PIXFORMAT_YUV422, WIDTH, HEIGHT);
+    CHECK(same_state());
+    CHECK(sensor.actions == ref.actions);
+
+    // A second init soft-resets the sensor: the shadow starts over as at power
+    // on, so the same registers go out again.
+    counters_clear();
+    config.pixformat = PIXFORMAT_RGB565;
+    bus_reset();
+    ov2640_init(&config);
+    ref_init(PIXFORMAT_RGB565, WIDTH, HEIGHT);
+    CHECK(same_state());
+    printf("init after reset: %u writes\n", (unsigned)sensor.writes);
+    CHECK(sensor.writes == init_writes);
+    return test_result("test_sccb");
+}
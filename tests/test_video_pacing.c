@@ -0,0 +1,120 @@
+/**
+ * video_pacing.h on a fake FreeRTOS tick: frame slots of the committed interval
+ * with no drift when it is not a whole number of ticks, an overrunning frame
+ * followed by the next slot on the same grid instead of a burst, and a mode
+ * change that starts the grid over instead of catching up the old one.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdbool.h>
+
+#include "test_common.h"
+#include "video_pacing.h"
+
+static TickType_t now;
+
+TickType_t xTaskGetTickCount(void) {
+    return now;
+}
+
+BaseType_t xTaskDelayUntil(TickType_t *previous_wake, TickType_t increment) {
+    TickType_t wake = *previous_wake + increment;
+    bool delay = (int32_t)(wake - now) > 0;
+    *previous_wake = wake;
+    if (!delay)
+        return pdFALSE;
+    now = wake;
+    return pdTRUE;
+}
+
+static TickType_t us_to_ticks(uint64_t us) {
+    return (TickType_t)(us * configTICK_RATE_HZ / 1000000);
+}
+
+// Idle frames at interval_us land on the exact tick of each slot, whole or not.
+static void commit_interval(uint32_t interval_us) {
+    struct video_pacing pacing = {0};
+    TickType_t start = now = 12345;
+    video_pacing_reset(&pacing);
+
+    for (uint32_t n = 1; n <= 900; n++) {
+        video_pacing_wait(&pacing, interval_us);
+        if (now - start != us_to_ticks((uint64_t)n * interval_us)) {
+            CHECK(!"slot off the committed interval");
+            break;
+        }
+    }
+    CHECK(pacing.overruns == 0 && pacing.skipped == 0);
+    printf("%u us: %.4f fps over 900 slots\n", (unsigned)interval_us,
+           900.0 * configTICK_RATE_HZ / (now - start));
+}
+
+// A frame that takes longer than its slot: the next one starts at once, whole
+// slots missed are skipped, and the one after is back on the grid.
+static void overrun(void) {
+    struct video_pacing pacing = {0};
+    const uint32_t interval_us = 40000;
+    const TickType_t period = us_to_ticks(interval_us);
+    TickType_t start = now = 0;
+    video_pacing_reset(&pacing);
+
+    for (int n = 0; n < 3; n++)
+        video_pacing_wait(&pacing, interval_us);
+    CHECK(now == start + 3 * period);
+
+    // 2.5 slots of work: slot 4 starts late, slot 5 is skipped.
+    now += period * 5 / 2;
+    TickType_t late = now;
+    video_pacing_wait(&pacing, interval_us);
+    CHECK(now == late);
+    CHECK(pacing.overruns == 1 && pacing.skipped == 1);
+    video_pacing_wait(&pacing, interval_us);
+    CHECK(now == start + 6 * period);
+
+    // 1.2 slots: the next frame starts at once, nothing skipped, then the grid.
+    now += period * 6 / 5;
+    late = now;
+    video_pacing_wait(&pacing, interval_us);
+    CHECK(now == late);
+    CHECK(pacing.overruns == 2 && pacing.skipped == 1);
+    video_pacing_wait(&pacing, interval_us);
+    CHECK(now == start + 8 * period);
+}
+
+// A new mode paces from the moment it is applied, a whole new interval away.
+static void mode_change(void) {
+    struct video_pacing pacing = {0};
+    now = 500;
+    video_pacing_reset(&pacing);
+
+    for (int n = 0; n < 10; n++)
+        video_pacing_wait(&pacing, 33333);
+
+    // Half way into a 30 fps slot, the host commits 10 fps.
+    now += us_to_ticks(16000);
+    TickType_t reset = now;
+    video_pacing_reset(&pacing);
+    for (int n = 1; n <= 5; n++) {
+        video_pacing_wait(&pacing, 100000);
+        CHECK(now == reset + n * us_to_ticks(100000));
+    }
+
+    // The stream stops for 5 s, then a mode is committed again: no burst of
+    // frames for the slots in between, nothing counted as overrun.
+    now += us_to_ticks(5000000);
+    reset = now;
+    video_pacing_reset(&pacing);
+    video_pacing_wait(&pacing, 40000);
+    CHECK(now == reset + us_to_ticks(40000));
+    CHECK(pacing.overruns == 0 && pacing.skipped == 0);
+}
+
+int main(void) {
+    commit_interval(33333);  // 30 fps, 666.66 ticks
+    commit_interval(40000);  // 25 fps, 800 ticks
+    commit_interval(166666); // 6 fps
+    overrun();
+    mode_change();
+    return test_result("test_video_pacing");
+}
@@ -0,0 +1,116 @@
+/**
+ * NV12 and I420 built in place by yuv420_pack_rows() and yuv420_planarize(), from
+ * YUYV and from RGB565 frames, against a floating point reference: full range
+ * BT.601 (JFIF) for RGB565, as rgb565_to_yuv422() converts, and chroma averaged
+ * over each 2x2 block. Every frame size the UVC stream offers, plus small ones.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "test_common.h"
+#include "yuv.h"
+
+#define MAX_WIDTH 320
+#define MAX_HEIGHT 240
+#define FRAMES 100
+
+static uint8_t buf[MAX_WIDTH * MAX_HEIGHT * 2] __attribute__((aligned(4)));
+static uint8_t src[MAX_WIDTH * MAX_HEIGHT * 2];
+static uint8_t scratch[YUV420_SCRATCH_SIZE(MAX_WIDTH, MAX_HEIGHT)] __attribute__((aligned(4)));
+static double ref_y[MAX_WIDTH * MAX_HEIGHT], ref_u[MAX_WIDTH * MAX_HEIGHT], ref_v[MAX_WIDTH * MAX_HEIGHT];
+
+static const char *const layout_names[] = {"NV12", "I420"};
+
+static double clamp(double x) {
+    return x < 0 ? 0 : x > 255 ? 255 : x;
+}
+
+// Full resolution Y, U and V of every pixel of the source frame.
+static void ref_yuv(int width, int height, bool rgb565) {
+    for (int i = 0; i < width * height; i++) {
+        if (rgb565) {
+            uint8_t rgb[3];
+            color16to24((uint16_t)(src[2 * i] | src[2 * i + 1] << 8), rgb);
+            ref_y[i] = 0.299 * rgb[0] + 0.587 * rgb[1] + 0.114 * rgb[2];
+            ref_u[i] = -0.168736 * rgb[0] - 0.331264 * rgb[1] + 0.5 * rgb[2] + 128;
+            ref_v[i] = 0.5 * rgb[0] - 0.418688 * rgb[1] - 0.081312 * rgb[2] + 128;
+        } else {
+            const uint8_t *px = &src[i / 2 * 4];
+            ref_y[i] = px[i % 2 * 2];
+            ref_u[i] = px[1];
+            ref_v[i] = px[3];
+        }
+    }
+}
+
+static void convert(int width, int height, enum yuv420_layout layout, bool rgb565) {
+    for (int pair = 0; pair < height / 2; pair++)
+        yuv420_pack_rows(buf, width, pair, layout, rgb565, scratch);
+    yuv420_planarize(buf, width, height, layout, scratch);
+}
+
+// Largest difference from the reference, over the Y plane and both chroma planes.
+static double check_frame(int width, int height, enum yuv420_layout layout, bool rgb565) {
+    uint32_t seed = (uint32_t)(width * height * 4 + layout * 2 + rgb565);
+    const uint8_t *y_plane = buf, *c_plane = buf + width * height;
+    double err = 0;
+
+    for (int i = 0; i < width * height * 2; i++)
+        src[i] = (uint8_t)test_rand(&seed);
+    memcpy(buf, src, (size_t)width * height * 2);
+    ref_yuv(width, height, rgb565);
+    convert(width, height, layout, rgb565);
+
+    for (int i = 0; i < width * height; i++)
+        err = fmax(err, fabs(y_plane[i] - clamp(ref_y[i])));
+    for (int cy = 0; cy < height / 2; cy++) {
+        for (int cx = 0; cx < width / 2; cx++) {
+            int p = 2 * cy * width + 2 * cx;
+            double u = (ref_u[p] + ref_u[p + 1] + ref_u[p + width] + ref_u[p + width + 1]) / 4;
+            double v = (ref_v[p] + ref_v[p + 1] + ref_v[p + width] + ref_v[p + width + 1]) / 4;
+            int got_u, got_v;
+
+            if (layout == YUV420_NV12) {
+                got_u = c_plane[cy * width + 2 * cx];
+                got_v = c_plane[cy * width + 2 * cx + 1];
+            } else {
+                got_u = c_plane[cy * width / 2 + cx];
+                got_v = c_plane[width * height / 4 + cy * width / 2 + cx];
+            }
+            err = fmax(err, fabs(got_u - clamp(u)));
+            err = fmax(err, fabs(got_v - clamp(v)));
+        }
+    }
+    return err;
+}
+
+int main(void) {
+    static const int sizes[][2] = {{320, 240}, {176, 144}, {160, 120}, {4, 2}, {8, 2}, {12, 6}};
+    double t0;
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for (int layout = YUV420_NV12; layout <= YUV420_I420; layout++) {
+            for (int rgb565 = 0; rgb565 < 2; rgb565++) {
+                double err = check_frame(sizes[s][0], sizes[s][1], layout, rgb565);
+                // YUYV chroma is rounded once, RGB565 through fixed point as well.
+                CHECK(err <= (rgb565 ? 1.0 : 0.5));
+                if (s == 0)
+                    printf("%dx%d %s from %s: max error %.2f\n", sizes[s][0], sizes[s][1], layout_names[layout],
+                           rgb565 ? "rgb565" : "yuyv", err);
+            }
+        }
+    }
+
+    for (int layout = YUV420_NV12; layout <= YUV420_I420; layout++) {
+        t0 = test_seconds();
+        for (int n = 0; n < FRAMES; n++) {
+            memcpy(buf, src, sizeof(buf));
+            convert(MAX_WIDTH, MAX_HEIGHT, layout, false);
+        }
+        printf("320x240 %s from yuyv: %.1f us/frame\n", layout_names[layout], (test_seconds() - t0) * 1e6 / FRAMES);
+    }
+    return test_result("test_yuv420");
+}
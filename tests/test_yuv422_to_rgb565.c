@@ -0,0 +1,48 @@
+/**
+ * yuv422_to_rgb565_words() against VP8YuvToRgb565(), which the LCD preview used to
+ * call once per pixel: every Y, U and V combination, and a QVGA benchmark.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+
+#include "reference.h"
+#include "test_common.h"
+
+#define WORDS (320 * 240 / 2)
+#define FRAMES 100
+
+static uint32_t in[WORDS], out[WORDS], ref[WORDS];
+
+int main(void) {
+    uint32_t seed = 22;
+    double t0, t_lut, t_ref;
+
+    // Every Y, U and V, the second pixel of a word with the complement of Y.
+    for (uint32_t base = 0; base < 1u << 24; base += WORDS) {
+        for (int i = 0; i < WORDS; i++) {
+            uint32_t yuv = base + i;
+            in[i] = (yuv & 0xff) | (yuv >> 8 & 0xff) << 8 | (~yuv & 0xff) << 16 | (yuv >> 16) << 24;
+        }
+        yuv422_to_rgb565_words(in, out, WORDS);
+        ref_yuv422_to_rgb565_words(in, ref, WORDS);
+        CHECK(memcmp(out, ref, sizeof(out)) == 0);
+    }
+
+    for (int i = 0; i < WORDS; i++)
+        in[i] = test_rand(&seed);
+    t0 = test_seconds();
+    for (int n = 0; n < FRAMES; n++)
+        yuv422_to_rgb565_words(in, out, WORDS);
+    t_lut = test_seconds() - t0;
+    t0 = test_seconds();
+    for (int n = 0; n < FRAMES; n++)
+        ref_yuv422_to_rgb565_words(in, ref, WORDS);
+    t_ref = test_seconds() - t0;
+    CHECK(memcmp(out, ref, sizeof(out)) == 0);
+
+    printf("320x240 random yuv422_to_rgb565_words: %.1f us/frame, VP8YuvToRgb565 per pixel %.1f us/frame (%.2fx)\n",
+           t_lut * 1e6 / FRAMES, t_ref * 1e6 / FRAMES, t_ref / t_lut);
+    return test_result("test_yuv422_to_rgb565");
+}
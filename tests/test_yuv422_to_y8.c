@@ -0,0 +1,74 @@
+/**
+ * yuv422_to_y8() against a byte at a time copy of the Y bytes: odd and even
+ * lengths, in place in the chunks video_frame_send() uses for GREY, and a QVGA
+ * benchmark.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+
+#include "test_common.h"
+#include "yuv.h"
+
+#define WIDTH 320
+#define HEIGHT 240
+#define WORDS (WIDTH * HEIGHT / 2)
+#define CHUNK (WIDTH * 2 * 8) // VIDEO_LCD_CHUNK
+#define FRAMES 1000
+
+static uint32_t in[WORDS], buf[WORDS];
+static uint8_t out[WORDS * 2 + 8] __attribute__((aligned(4))), ref[WORDS * 2];
+
+static void ref_yuv422_to_y8(const uint32_t *src, uint8_t *dst, int len) {
+    for (int i = 0; i < len; i++) {
+        dst[2 * i] = (uint8_t)src[i];
+        dst[2 * i + 1] = (uint8_t)(src[i] >> 16);
+    }
+}
+
+int main(void) {
+    uint32_t seed = 23;
+    double t0, t_word, t_ref;
+
+    for (int i = 0; i < WORDS; i++)
+        in[i] = test_rand(&seed);
+
+    // Every length up to a few words, nothing written past 2 * len bytes.
+    for (int len = 0; len <= 9; len++) {
+        memset(out, 0xa5, sizeof(out));
+        yuv422_to_y8(in, out, len);
+        ref_yuv422_to_y8(in, ref, len);
+        CHECK(memcmp(out, ref, (size_t)len * 2) == 0);
+        for (int i = len * 2; i < len * 2 + 8; i++)
+            CHECK(out[i] == 0xa5);
+    }
+
+    // In place, chunk by chunk behind the LCD push, as the GREY format does.
+    memcpy(buf, in, sizeof(in));
+    for (size_t off = 0; off < sizeof(buf); off += CHUNK) {
+        size_t len = sizeof(buf) - off < CHUNK ? sizeof(buf) - off : CHUNK;
+        yuv422_to_y8((const uint32_t *)((uint8_t *)buf + off), (uint8_t *)buf + off / 2, (int)(len / 4));
+    }
+    ref_yuv422_to_y8(in, ref, WORDS);
+    CHECK(memcmp(buf, ref, WORDS * 2) == 0);
+
+    // The whole frame in place in one call, and an odd length.
+    memcpy(buf, in, sizeof(in));
+    yuv422_to_y8(buf, (uint8_t *)buf, WORDS - 1);
+    CHECK(memcmp(buf, ref, (WORDS - 1) * 2) == 0);
+
+    t0 = test_seconds();
+    for (int n = 0; n < FRAMES; n++)
+        yuv422_to_y8(in, out, WORDS);
+    t_word = test_seconds() - t0;
+    t0 = test_seconds();
+    for (int n = 0; n < FRAMES; n++)
+        ref_yuv422_to_y8(in, ref, WORDS);
+    t_ref = test_seconds() - t0;
+    CHECK(memcmp(out, ref, WORDS * 2) == 0);
+
+    printf("320x240 yuv422_to_y8: %.1f us/frame, byte at a time %.1f us/frame (%.2fx)\n", t_word * 1e6 / FRAMES,
+           t_ref * 1e6 / FRAMES, t_ref / t_word);
+    return test_result("test_yuv422_to_y8");
+}
@@ -101,11 +101,25 @@
 // The number of video streaming interfaces
 #define CFG_TUD_VIDEO_STREAMING  1
 
-// video streaming endpoint size
-#define CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE  256
+ // use bulk endpoint for streaming interface, otherwise isochronous alternate settings
+#ifndef CFG_TUD_VIDEO_STREAMING_BULK
+#define CFG_TUD_VIDEO_STREAMING_BULK 1
+#endif
+
+// Largest UVC payload on a bulk endpoint. A payload is one transfer of many 64-byte
+// packets with a single header, tinyusb reports the smaller of this and the frame
+// bytes per ms of frame interval as dwMaxPayloadTransferSize.
+#ifndef CFG_TUD_VIDEO_STREAMING_BULK_PAYLOAD
+#define CFG_TUD_VIDEO_STREAMING_BULK_PAYLOAD (8 * 1024)
+#endif
 
- // use bulk endpoint for streaming interface
-#define CFG_TUD_VIDEO_STREAMING_BULK 0
+// video streaming endpoint size: one bulk payload, or the largest isochronous
+// packet in UVC_ISO_PACKET_SIZES
+#if CFG_TUD_VIDEO_STREAMING_BULK
+#define CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE  CFG_TUD_VIDEO_STREAMING_BULK_PAYLOAD
+#else
+#define CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE  1023
+#endif
 
 #ifdef __cplusplus
  }
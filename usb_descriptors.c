@@ -77,9 +77,14 @@ uint8_t const * tud_descriptor_device_cb(void)
 // Configuration Descriptor
 //--------------------------------------------------------------------+
 
-#define CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + TUD_VIDEO_CAPTURE_DESC_UNCOMPR_BULK_LEN)
+#if CFG_TUD_VIDEO_STREAMING_BULK
+#define CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + TUD_VIDEO_CAPTURE_DESC_TOTAL_BULK_LEN)
+#else
+#define CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + TUD_VIDEO_CAPTURE_DESC_TOTAL_ISO_LEN)
+#endif
 
 #if 0
+#define CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + TUD_VIDEO_CAPTURE_DESC_UNCOMPR_BULK_LEN)
 #define CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + TUD_VIDEO_CAPTURE_DESC_UNCOMPR_LEN)
 #define CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + TUD_VIDEO_CAPTURE_DESC_MJPEG_LEN)
 #endif // not working defines
@@ -93,10 +98,15 @@ uint8_t const desc_fs_configuration[] =
 
         // IAD for Video Control
 
+#if CFG_TUD_VIDEO_STREAMING_BULK
+        TUD_VIDEO_CAPTURE_DESCRIPTOR_TOTAL_BULK(4, EPNUM_VIDEO_IN, 64),
+#else
+        TUD_VIDEO_CAPTURE_DESCRIPTOR_TOTAL_ISO(4, EPNUM_VIDEO_IN)
+#endif
+#if 0
         TUD_VIDEO_CAPTURE_DESCRIPTOR_UNCOMPR_BULK(4, EPNUM_VIDEO_IN,
                                                   FRAME_WIDTH, FRAME_HEIGHT, FRAME_RATE,
                                                   64),
-#if 0
         TUD_VIDEO_CAPTURE_DESCRIPTOR_UNCOMPR(4, EPNUM_VIDEO_IN,
                                              FRAME_WIDTH, FRAME_HEIGHT, FRAME_RATE,
                                              CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE)
@@ -41,6 +41,69 @@
 
 #define FRAME_RATE    25
 
+/* Frame sizes offered to the host, as X(bFrameIndex, width, height, fps). Each one
+ * must be in ov2640_supported_win_sizes and fit in the FRAME_WIDTH x FRAME_HEIGHT
+ * buffer; smaller frames can run at a higher rate. */
+#define UVC_FRAME_SIZES(X) \
+  X(1, FRAME_WIDTH, FRAME_HEIGHT, FRAME_RATE) /* QVGA */ \
+  X(2, 176, 144, 30)                          /* QCIF */ \
+  X(3, 160, 120, 30)                          /* QQVGA */
+#define UVC_FRAME_COUNT 3
+
+/* MJPEG frame sizes, same layout. The sensor compresses them, a frame only has to
+ * fit in UVC_MJPEG_MAX_FRAME_SIZE, so these can be larger than the raw ones. */
+#define UVC_MJPEG_FRAME_SIZES(X) \
+  X(1, 320, 240, 30) /* QVGA */ \
+  X(2, 640, 480, 15) /* VGA */ \
+  X(3, 800, 600, 10) /* SVGA */
+#define UVC_MJPEG_FRAME_COUNT 3
+#define UVC_MJPEG_MAX_FRAME_SIZE (FRAME_WIDTH * FRAME_HEIGHT * 2)
+
+/* Isochronous alternate settings of the streaming interface, as X(bAlternateSetting,
+ * wMaxPacketSize). At full speed one packet goes out per 1 ms frame, so they reserve
+ * 128 KB/s up to 1023 KB/s. The host picks the smallest one that carries the
+ * dwMaxPayloadTransferSize of the committed format and frame interval. */
+#define UVC_ISO_PACKET_SIZES(X, ...) \
+  X(1, 128, __VA_ARGS__) \
+  X(2, 256, __VA_ARGS__) \
+  X(3, 512, __VA_ARGS__) \
+  X(4, 1023, __VA_ARGS__)
+#define UVC_ISO_ALT_COUNT 4
+
+/* Frame bytes per second the streaming endpoint carries at full speed: one 1023 byte
+ * isochronous packet per 1 ms frame less its 2 byte header, or at best 19 64 byte
+ * bulk packets per frame. tinyusb sizes bulk payloads per whole ms of frame interval,
+ * header included, so the last packet of each is short; budget one packet for it. */
+#if CFG_TUD_VIDEO_STREAMING_BULK
+#define UVC_STREAM_BYTES_PER_SEC ((18 * 64 - 2) * 1000ULL)
+#else
+#define UVC_STREAM_BYTES_PER_SEC ((1023 - 2) * 1000ULL)
+#endif
+
+/* Frame intervals in 100 ns units. A frame size is offered at its UVC_FRAME_SIZES()
+ * rate only if the endpoint can carry _bytes per frame at that rate, otherwise at the
+ * fastest one it can: QVGA YUY2 (153600 bytes) comes out at 6.6 fps on isochronous.
+ * Slower intervals go in whole multiples of the fastest one, up to one second. */
+#define UVC_INTERVAL_BW(_bytes) (((_bytes) * 10000000ULL + UVC_STREAM_BYTES_PER_SEC - 1) / UVC_STREAM_BYTES_PER_SEC)
+#define UVC_INTERVAL(_bytes, _fps) \
+  (10000000ULL / (_fps) > UVC_INTERVAL_BW(_bytes) ? 10000000ULL / (_fps) : UVC_INTERVAL_BW(_bytes))
+#define UVC_INTERVAL_MAX(_bytes, _fps) \
+  (UVC_INTERVAL(_bytes, _fps) < 10000000 ? 10000000 / UVC_INTERVAL(_bytes, _fps) * UVC_INTERVAL(_bytes, _fps) \
+                                         : UVC_INTERVAL(_bytes, _fps))
+/* Bits per second of _bytes frames at that interval. */
+#define UVC_BIT_RATE(_bytes, _fps) ((_bytes) * 8 * 10000000ULL / UVC_INTERVAL(_bytes, _fps))
+
+/* bFormatIndex of the formats in TUD_VIDEO_CAPTURE_DESCRIPTOR_TOTAL_BULK/ISO().
+ * GREY (Y800), NV12, I420 and RGBP (RGB565) have the UVC_FRAME_SIZES() list of
+ * YUY2, at half, three quarters and all of its bytes. */
+#define UVC_FORMAT_YUY2  1
+#define UVC_FORMAT_MJPEG 2
+#define UVC_FORMAT_GREY  3
+#define UVC_FORMAT_NV12  4
+#define UVC_FORMAT_I420  5
+#define UVC_FORMAT_RGBP  6
+#define UVC_FORMAT_COUNT 6
+
 enum {
   ITF_NUM_VIDEO_CONTROL,
   ITF_NUM_VIDEO_STREAMING,
@@ -94,7 +157,7 @@ enum {
     + TUD_VIDEO_DESC_STD_VS_LEN\
     + (TUD_VIDEO_DESC_CS_VS_IN_LEN + 1/*bNumFormats x bControlSize*/)\
     + TUD_VIDEO_DESC_CS_VS_FMT_UNCOMPR_LEN\
-    + TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT_LEN\
+    + TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT_LEN * UVC_FRAME_COUNT\
     + TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING_LEN\
     + 7/* Endpoint */\
   )
@@ -105,7 +168,9 @@ enum {
     + TUD_VIDEO_DESC_STD_VS_LEN + (TUD_VIDEO_DESC_CS_VS_IN_LEN + 1 /*bNumFormats x bControlSize*/) + TUD_VIDEO_DESC_CS_VS_FMT_MJPEG_LEN + TUD_VIDEO_DESC_CS_VS_FRM_MJPEG_CONT_LEN + TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING_LEN + 7 /* Endpoint */                 \
 )
 
-#define TUD_VIDEO_CAPTURE_DESC_TOTAL_LEN (\
+/* Video control interface and VS input header with both formats, shared by the
+ * bulk and isochronous variants below. */
+#define TUD_VIDEO_CAPTURE_DESC_TOTAL_FORMATS_LEN (\
     TUD_VIDEO_DESC_IAD_LEN\
     /* control */\
     + TUD_VIDEO_DESC_STD_VC_LEN\
@@ -114,16 +179,29 @@ enum {
     + TUD_VIDEO_DESC_OUTPUT_TERM_LEN\
     /* Interface 1, Alternate 0 */\
     + TUD_VIDEO_DESC_STD_VS_LEN\
-    + (TUD_VIDEO_DESC_CS_VS_IN_LEN + 1/*bNumFormats x bControlSize*/)\
-    + TUD_VIDEO_DESC_CS_VS_FMT_UNCOMPR_LEN \
-    + TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT_LEN * 3\
-    + (TUD_VIDEO_DESC_CS_VS_IN_LEN + 1/*bNumFormats x bControlSize*/)\
-    + TUD_VIDEO_DESC_CS_VS_FMT_MJPEG_LEN \
-    + TUD_VIDEO_DESC_CS_VS_FRM_MJPEG_CONT_LEN * 3\
+    + (TUD_VIDEO_DESC_CS_VS_IN_LEN + UVC_FORMAT_COUNT/*bNumFormats x bControlSize*/)\
+    + TUD_VIDEO_DESC_CS_VS_FMT_UNCOMPR_LEN\
+    + TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT_LEN * UVC_FRAME_COUNT\
+    + TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING_LEN\
+    + TUD_VIDEO_DESC_CS_VS_FMT_MJPEG_LEN\
+    + TUD_VIDEO_DESC_CS_VS_FRM_MJPEG_CONT_LEN * UVC_MJPEG_FRAME_COUNT\
     + TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING_LEN\
+    + (TUD_VIDEO_DESC_CS_VS_FMT_UNCOMPR_LEN\
+       + TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT_LEN * UVC_FRAME_COUNT\
+       + TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING_LEN) * 4 /* GREY, NV12, I420, RGBP */\
+  )
+
+#define TUD_VIDEO_CAPTURE_DESC_TOTAL_BULK_LEN (\
+    TUD_VIDEO_CAPTURE_DESC_TOTAL_FORMATS_LEN\
     + 7/* Endpoint */\
   )
 
+#define TUD_VIDEO_CAPTURE_DESC_TOTAL_ISO_LEN (\
+    TUD_VIDEO_CAPTURE_DESC_TOTAL_FORMATS_LEN\
+    /* Interface 1, Alternates 1..UVC_ISO_ALT_COUNT */\
+    + (TUD_VIDEO_DESC_STD_VS_LEN + 7/* Endpoint */) * UVC_ISO_ALT_COUNT\
+  )
+
 /* Windows support YUY2 and NV12
  * https://docs.microsoft.com/en-us/windows-hardware/drivers/stream/usb-video-class-driver-overview */
 
@@ -136,6 +214,16 @@ enum {
 #define TUD_VIDEO_DESC_CS_VS_FMT_I420(_fmtidx, _numfmtdesc, _frmidx, _asrx, _asry, _interlace, _cp) \
   TUD_VIDEO_DESC_CS_VS_FMT_UNCOMPR(_fmtidx, _numfmtdesc, TUD_VIDEO_GUID_I420, 12, _frmidx, _asrx, _asry, _interlace, _cp)
 
+/* 8-bit luma only, GREY on Linux. tinyusb has no GUID for it. */
+#define UVC_GUID_Y800 0x59,0x38,0x30,0x30,0x00,0x00,0x10,0x00,0x80,0x00,0x00,0xAA,0x00,0x38,0x9B,0x71
+#define TUD_VIDEO_DESC_CS_VS_FMT_Y800(_fmtidx, _numfmtdesc, _frmidx, _asrx, _asry, _interlace, _cp) \
+  TUD_VIDEO_DESC_CS_VS_FMT_UNCOMPR(_fmtidx, _numfmtdesc, UVC_GUID_Y800, 8, _frmidx, _asrx, _asry, _interlace, _cp)
+
+/* Little endian RGB565, V4L2_PIX_FMT_RGB565 on Linux, as the sensor writes it. */
+#define UVC_GUID_RGBP 0x52,0x47,0x42,0x50,0x00,0x00,0x10,0x00,0x80,0x00,0x00,0xAA,0x00,0x38,0x9B,0x71
+#define TUD_VIDEO_DESC_CS_VS_FMT_RGBP(_fmtidx, _numfmtdesc, _frmidx, _asrx, _asry, _interlace, _cp) \
+  TUD_VIDEO_DESC_CS_VS_FMT_UNCOMPR(_fmtidx, _numfmtdesc, UVC_GUID_RGBP, 16, _frmidx, _asrx, _asry, _interlace, _cp)
+
 #define TUD_VIDEO_CAPTURE_DESCRIPTOR_UNCOMPR(_stridx, _epin, _width, _height, _fps, _epsize) \
   TUD_VIDEO_DESC_IAD(ITF_NUM_VIDEO_CONTROL, /* 2 Interfaces */ 0x02, _stridx), \
   /* Video control 0 */ \
@@ -211,6 +299,41 @@ enum {
     TUD_VIDEO_DESC_EP_ISO(_epin, _epsize, 1)
 
 
+/* One MJPEG frame descriptor per UVC_MJPEG_FRAME_SIZES() entry, comma included.
+ * The bit rates and intervals assume about 8:1 compression. */
+#define UVC_MJPEG_BYTES(_width, _height) ((_width) * (_height) * 2 / 8)
+#define TUD_VIDEO_DESC_CS_VS_FRM_MJPEG_SIZE(_frmidx, _width, _height, _fps) \
+  TUD_VIDEO_DESC_CS_VS_FRM_MJPEG_CONT(_frmidx, 0, _width, _height, \
+      UVC_MJPEG_BYTES(_width, _height) * 8, UVC_BIT_RATE(UVC_MJPEG_BYTES(_width, _height), _fps), \
+      UVC_MJPEG_MAX_FRAME_SIZE, \
+      UVC_INTERVAL(UVC_MJPEG_BYTES(_width, _height), _fps), UVC_INTERVAL(UVC_MJPEG_BYTES(_width, _height), _fps), \
+      UVC_INTERVAL_MAX(UVC_MJPEG_BYTES(_width, _height), _fps), UVC_INTERVAL(UVC_MJPEG_BYTES(_width, _height), _fps)),
+
+/* One YUY2 (or RGBP, also 16 bits) frame descriptor per UVC_FRAME_SIZES() entry,
+ * comma included. */
+#define TUD_VIDEO_DESC_CS_VS_FRM_YUY2_CONT(_frmidx, _width, _height, _fps) \
+  TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT(_frmidx, 0, _width, _height, \
+      _width * _height * 16, UVC_BIT_RATE(_width * _height * 2, _fps), \
+      _width * _height * 2, \
+      UVC_INTERVAL(_width * _height * 2, _fps), UVC_INTERVAL(_width * _height * 2, _fps), \
+      UVC_INTERVAL_MAX(_width * _height * 2, _fps), UVC_INTERVAL(_width * _height * 2, _fps)),
+
+/* One GREY frame descriptor per UVC_FRAME_SIZES() entry, comma included. */
+#define TUD_VIDEO_DESC_CS_VS_FRM_Y800_CONT(_frmidx, _width, _height, _fps) \
+  TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT(_frmidx, 0, _width, _height, \
+      _width * _height * 8, UVC_BIT_RATE(_width * _height, _fps), \
+      _width * _height, \
+      UVC_INTERVAL(_width * _height, _fps), UVC_INTERVAL(_width * _height, _fps), \
+      UVC_INTERVAL_MAX(_width * _height, _fps), UVC_INTERVAL(_width * _height, _fps)),
+
+/* Same for the 4:2:0 formats, NV12 and I420. */
+#define TUD_VIDEO_DESC_CS_VS_FRM_YUV420_CONT(_frmidx, _width, _height, _fps) \
+  TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT(_frmidx, 0, _width, _height, \
+      _width * _height * 12, UVC_BIT_RATE(_width * _height * 3 / 2, _fps), \
+      _width * _height * 3 / 2, \
+      UVC_INTERVAL(_width * _height * 3 / 2, _fps), UVC_INTERVAL(_width * _height * 3 / 2, _fps), \
+      UVC_INTERVAL_MAX(_width * _height * 3 / 2, _fps), UVC_INTERVAL(_width * _height * 3 / 2, _fps)),
+
 #define TUD_VIDEO_CAPTURE_DESCRIPTOR_UNCOMPR_BULK(_stridx, _epin, _width, _height, _fps, _epsize) \
   TUD_VIDEO_DESC_IAD(ITF_NUM_VIDEO_CONTROL, /* 2 Interfaces */ 0x02, _stridx), \
   /* Video control 0 */ \
@@ -229,19 +352,16 @@ enum {
     TUD_VIDEO_DESC_CS_VS_INPUT( /*bNumFormats*/1, \
         /*wTotalLength - bLength */\
         TUD_VIDEO_DESC_CS_VS_FMT_UNCOMPR_LEN\
-        + TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT_LEN\
+        + TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT_LEN * UVC_FRAME_COUNT\
         + TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING_LEN,\
         _epin, /*bmInfo*/0, /*bTerminalLink*/UVC_ENTITY_CAP_OUTPUT_TERMINAL, \
         /*bStillCaptureMethod*/0, /*bTriggerSupport*/0, /*bTriggerUsage*/0, \
         /*bmaControls(1)*/0), \
       /* Video stream format */ \
-      TUD_VIDEO_DESC_CS_VS_FMT_YUY2(/*bFormatIndex*/1, /*bNumFrameDescriptors*/1, \
+      TUD_VIDEO_DESC_CS_VS_FMT_YUY2(/*bFormatIndex*/1, /*bNumFrameDescriptors*/UVC_FRAME_COUNT, \
         /*bDefaultFrameIndex*/1, 0, 0, 0, /*bCopyProtect*/0), \
-        /* Video stream frame format */ \
-        TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT(/*bFrameIndex */1, 0, _width, _height, \
-            _width * _height * 16, _width * _height * 16 * _fps, \
-            _width * _height * 16, \
-            (10000000/_fps), (10000000/_fps), (10000000/_fps)*_fps, (10000000/_fps)), \
+        /* Video stream frame formats, taken from UVC_FRAME_SIZES() */ \
+        UVC_FRAME_SIZES(TUD_VIDEO_DESC_CS_VS_FRM_YUY2_CONT) \
         TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING(VIDEO_COLOR_PRIMARIES_BT709, VIDEO_COLOR_XFER_CH_BT709, VIDEO_COLOR_COEF_SMPTE170M), \
         TUD_VIDEO_DESC_EP_BULK(_epin, _epsize, 1)
 
@@ -270,56 +390,79 @@ enum {
         TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING(VIDEO_COLOR_PRIMARIES_BT709, VIDEO_COLOR_XFER_CH_BT709, VIDEO_COLOR_COEF_SMPTE170M), /* EP */                  \
         TUD_VIDEO_DESC_EP_BULK(_epin, _epsize, 1)
 
-#define TUD_VIDEO_CAPTURE_DESCRIPTOR_TOTAL_BULK(_stridx, _epin, _width, _height, _fps, _epsize)                                                                    \
-    TUD_VIDEO_DESC_IAD(ITF_NUM_VIDEO_CONTROL, /* 2 Interfaces */ 0x02, _stridx), /* Video control 0 */                                                             \
-        TUD_VIDEO_DESC_STD_VC(ITF_NUM_VIDEO_CONTROL, 0, _stridx),                                                                                                  \
-        TUD_VIDEO_DESC_CS_VC(/* UVC 1.5*/ 0x0150, /* wTotalLength - bLength */                                                                                     \
-                             TUD_VIDEO_DESC_CAMERA_TERM_LEN + TUD_VIDEO_DESC_OUTPUT_TERM_LEN,                                                                      \
-                             UVC_CLOCK_FREQUENCY, ITF_NUM_VIDEO_STREAMING),                                                                                        \
-        TUD_VIDEO_DESC_CAMERA_TERM(UVC_ENTITY_CAP_INPUT_TERMINAL, 0, 0,                                                                                            \
-                                   /*wObjectiveFocalLengthMin*/ 0, /*wObjectiveFocalLengthMax*/ 0,                                                                 \
-                                   /*wObjectiveFocalLength*/ 0, /*bmControls*/ 0),                                                                                 \
-        TUD_VIDEO_DESC_OUTPUT_TERM(UVC_ENTITY_CAP_OUTPUT_TERMINAL, VIDEO_TT_STREAMING, 0, 1, 0), /* Video stream alt. 0 */                                         \
-        TUD_VIDEO_DESC_STD_VS(ITF_NUM_VIDEO_STREAMING, 0, 1, _stridx),                           /* Video stream header for without still image capture */         \
-        TUD_VIDEO_DESC_CS_VS_INPUT(/*bNumFormats*/ 1,                                            /*wTotalLength - bLength */                                       \
-                                   TUD_VIDEO_DESC_CS_VS_FMT_UNCOMPR_LEN + TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT_LEN * 3 + TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING_LEN, \
-                                   _epin, /*bmInfo*/ 0, /*bTerminalLink*/ UVC_ENTITY_CAP_OUTPUT_TERMINAL,                                                          \
-                                   /*bStillCaptureMethod*/ 0, /*bTriggerSupport*/ 0, /*bTriggerUsage*/ 0,                                                          \
-                                   /*bmaControls(1)*/ 0), /* Video stream format */                                                                                \
-        TUD_VIDEO_DESC_CS_VS_FMT_YUY2(/*bFormatIndex*/ 1, /*bNumFrameDescriptors*/ 3,                                                                              \
-                                      /*bDefaultFrameIndex*/ 1, 0, 0, 0, /*bCopyProtect*/ 0), /* Video stream frame format */                                      \
-        TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT(/*bFrameIndex */ 1, 0, _width, _height,                                                                              \
-                                              _width *_height * 16, _width * _height * 16 * _fps,                                                                  \
-                                              _width * _height * 16,                                                                                               \
-                                              (10000000 / _fps), (10000000 / _fps), (10000000 / _fps) * _fps, (10000000 / _fps)),                                  \
-        TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT(/*bFrameIndex */ 2, 0, _width / 2, _height / 2,                                                                      \
-                                              _width * _height * 16 / 2, _width * _height * 16 / 2 * _fps,                                                         \
-                                              _width * _height * 16 / 2,                                                                                           \
-                                              (10000000 / _fps), (10000000 / _fps), (10000000 / _fps) * _fps, (10000000 / _fps)),                                  \
-        TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT(/*bFrameIndex */ 3, 0, _width / 4, _height / 4,                                                                      \
-                                              _width * _height * 16 / 4, _width * _height * 16 / 4 * _fps,                                                         \
-                                              _width * _height * 16 / 4,                                                                                           \
-                                              (10000000 / _fps), (10000000 / _fps), (10000000 / _fps) * _fps, (10000000 / _fps)),                                  \
-        TUD_VIDEO_DESC_CS_VS_INPUT(/*bNumFormats*/ 1, /*wTotalLength - bLength */                                                                                  \
-                                   TUD_VIDEO_DESC_CS_VS_FMT_MJPEG_LEN + TUD_VIDEO_DESC_CS_VS_FRM_MJPEG_CONT_LEN * 3 + TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING_LEN,     \
-                                   _epin, /*bmInfo*/ 0, /*bTerminalLink*/ UVC_ENTITY_CAP_OUTPUT_TERMINAL,                                                          \
-                                   /*bStillCaptureMethod*/ 0, /*bTriggerSupport*/ 0, /*bTriggerUsage*/ 0,                                                          \
-                                   /*bmaControls(1)*/ 0), /* Video stream format */                                                                                \
-        TUD_VIDEO_DESC_CS_VS_FMT_MJPEG(/*bFormatIndex*/ 1, /*bNumFrameDescriptors*/ 3,                                                                             \
-                                       /*bmFlags*/ 0, /*bDefaultFrameIndex*/ 1, 0, 0, 0, /*bCopyProtect*/ 0), /* Video stream frame format */                      \
-        TUD_VIDEO_DESC_CS_VS_FRM_MJPEG_CONT(/*bFrameIndex */ 1, 0, _width, _height,                                                                                \
-                                            _width *_height * 16, _width * _height * 16 * _fps * 6,                                                                \
-                                            _width * _height * 16 / 8,                                                                                             \
-                                            (10000000 / _fps * 6), (10000000 / _fps * 6), (10000000 / _fps * 6) * _fps * 6, (10000000 / _fps * 6)),                \
-        TUD_VIDEO_DESC_CS_VS_FRM_MJPEG_CONT(/*bFrameIndex */ 2, 0, _width / 2, _height / 2,                                                                        \
-                                            _width * _height * 16 / 2, _width * _height * 16 / 2 * _fps,                                                           \
-                                            _width * _height * 16 / 2 / 8,                                                                                         \
-                                            (10000000 / _fps), (10000000 / _fps), (10000000 / _fps) * _fps, (10000000 / _fps)),                                    \
-        TUD_VIDEO_DESC_CS_VS_FRM_MJPEG_CONT(/*bFrameIndex */ 3, 0, _width / 4, _height / 4,                                                                        \
-                                            _width * _height * 16 / 4, _width * _height * 16 / 4 * _fps,                                                           \
-                                            _width * _height * 16 / 4 / 8,                                                                                         \
-                                            (10000000 / _fps), (10000000 / _fps), (10000000 / _fps) * _fps, (10000000 / _fps)),                                    \
-        TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING(VIDEO_COLOR_PRIMARIES_BT709, VIDEO_COLOR_XFER_CH_BT709, VIDEO_COLOR_COEF_SMPTE170M),                                   \
+/* YUY2, MJPEG, GREY, NV12, I420 and RGBP on one streaming interface, the host picks
+ * one by bFormatIndex.
+ * _bulk_eps is 1 when the endpoint follows in alternate 0, 0 for isochronous. */
+#define TUD_VIDEO_CAPTURE_DESCRIPTOR_TOTAL_FORMATS(_stridx, _epin, _bulk_eps) \
+  TUD_VIDEO_DESC_IAD(ITF_NUM_VIDEO_CONTROL, /* 2 Interfaces */ 0x02, _stridx), \
+  /* Video control 0 */ \
+  TUD_VIDEO_DESC_STD_VC(ITF_NUM_VIDEO_CONTROL, 0, _stridx), \
+    TUD_VIDEO_DESC_CS_VC( /* UVC 1.5*/ 0x0150, \
+         /* wTotalLength - bLength */ \
+         TUD_VIDEO_DESC_CAMERA_TERM_LEN + TUD_VIDEO_DESC_OUTPUT_TERM_LEN, \
+         UVC_CLOCK_FREQUENCY, ITF_NUM_VIDEO_STREAMING), \
+      TUD_VIDEO_DESC_CAMERA_TERM(UVC_ENTITY_CAP_INPUT_TERMINAL, 0, 0,\
+                                 /*wObjectiveFocalLengthMin*/0, /*wObjectiveFocalLengthMax*/0,\
+                                 /*wObjectiveFocalLength*/0, /*bmControls*/0), \
+      TUD_VIDEO_DESC_OUTPUT_TERM(UVC_ENTITY_CAP_OUTPUT_TERMINAL, VIDEO_TT_STREAMING, 0, 1, 0), \
+  /* Video stream alt. 0 */ \
+  TUD_VIDEO_DESC_STD_VS(ITF_NUM_VIDEO_STREAMING, 0, _bulk_eps, _stridx), \
+    /* Video stream header for without still image capture */ \
+    TUD_VIDEO_DESC_CS_VS_INPUT( /*bNumFormats*/UVC_FORMAT_COUNT, \
+        /*wTotalLength - bLength */\
+        TUD_VIDEO_DESC_CS_VS_FMT_UNCOMPR_LEN\
+        + TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT_LEN * UVC_FRAME_COUNT\
+        + TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING_LEN\
+        + TUD_VIDEO_DESC_CS_VS_FMT_MJPEG_LEN\
+        + TUD_VIDEO_DESC_CS_VS_FRM_MJPEG_CONT_LEN * UVC_MJPEG_FRAME_COUNT\
+        + TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING_LEN\
+        + (TUD_VIDEO_DESC_CS_VS_FMT_UNCOMPR_LEN\
+           + TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT_LEN * UVC_FRAME_COUNT\
+           + TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING_LEN) * 4,\
+        _epin, /*bmInfo*/0, /*bTerminalLink*/UVC_ENTITY_CAP_OUTPUT_TERMINAL, \
+        /*bStillCaptureMethod*/0, /*bTriggerSupport*/0, /*bTriggerUsage*/0, \
+        /*bmaControls(1..6)*/0, 0, 0, 0, 0, 0), \
+      /* Video stream format */ \
+      TUD_VIDEO_DESC_CS_VS_FMT_YUY2(UVC_FORMAT_YUY2, /*bNumFrameDescriptors*/UVC_FRAME_COUNT, \
+        /*bDefaultFrameIndex*/1, 0, 0, 0, /*bCopyProtect*/0), \
+        /* Video stream frame formats, taken from UVC_FRAME_SIZES() */ \
+        UVC_FRAME_SIZES(TUD_VIDEO_DESC_CS_VS_FRM_YUY2_CONT) \
+        TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING(VIDEO_COLOR_PRIMARIES_BT709, VIDEO_COLOR_XFER_CH_BT709, VIDEO_COLOR_COEF_SMPTE170M), \
+      TUD_VIDEO_DESC_CS_VS_FMT_MJPEG(UVC_FORMAT_MJPEG, /*bNumFrameDescriptors*/UVC_MJPEG_FRAME_COUNT, \
+        /*bmFlags*/0, /*bDefaultFrameIndex*/1, 0, 0, 0, /*bCopyProtect*/0), \
+        /* Video stream frame formats, taken from UVC_MJPEG_FRAME_SIZES() */ \
+        UVC_MJPEG_FRAME_SIZES(TUD_VIDEO_DESC_CS_VS_FRM_MJPEG_SIZE) \
+        TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING(VIDEO_COLOR_PRIMARIES_BT709, VIDEO_COLOR_XFER_CH_BT709, VIDEO_COLOR_COEF_SMPTE170M), \
+      TUD_VIDEO_DESC_CS_VS_FMT_Y800(UVC_FORMAT_GREY, /*bNumFrameDescriptors*/UVC_FRAME_COUNT, \
+        /*bDefaultFrameIndex*/1, 0, 0, 0, /*bCopyProtect*/0), \
+        /* Video stream frame formats, taken from UVC_FRAME_SIZES() */ \
+        UVC_FRAME_SIZES(TUD_VIDEO_DESC_CS_VS_FRM_Y800_CONT) \
+        TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING(VIDEO_COLOR_PRIMARIES_BT709, VIDEO_COLOR_XFER_CH_BT709, VIDEO_COLOR_COEF_SMPTE170M), \
+      TUD_VIDEO_DESC_CS_VS_FMT_NV12(UVC_FORMAT_NV12, /*bNumFrameDescriptors*/UVC_FRAME_COUNT, \
+        /*bDefaultFrameIndex*/1, 0, 0, 0, /*bCopyProtect*/0), \
+        UVC_FRAME_SIZES(TUD_VIDEO_DESC_CS_VS_FRM_YUV420_CONT) \
+        TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING(VIDEO_COLOR_PRIMARIES_BT709, VIDEO_COLOR_XFER_CH_BT709, VIDEO_COLOR_COEF_SMPTE170M), \
+      TUD_VIDEO_DESC_CS_VS_FMT_I420(UVC_FORMAT_I420, /*bNumFrameDescriptors*/UVC_FRAME_COUNT, \
+        /*bDefaultFrameIndex*/1, 0, 0, 0, /*bCopyProtect*/0), \
+        UVC_FRAME_SIZES(TUD_VIDEO_DESC_CS_VS_FRM_YUV420_CONT) \
+        TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING(VIDEO_COLOR_PRIMARIES_BT709, VIDEO_COLOR_XFER_CH_BT709, VIDEO_COLOR_COEF_SMPTE170M), \
+      TUD_VIDEO_DESC_CS_VS_FMT_RGBP(UVC_FORMAT_RGBP, /*bNumFrameDescriptors*/UVC_FRAME_COUNT, \
+        /*bDefaultFrameIndex*/1, 0, 0, 0, /*bCopyProtect*/0), \
+        UVC_FRAME_SIZES(TUD_VIDEO_DESC_CS_VS_FRM_YUY2_CONT) \
+        TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING(VIDEO_COLOR_PRIMARIES_BT709, VIDEO_COLOR_XFER_CH_BT709, VIDEO_COLOR_COEF_SMPTE170M)
+
+#define TUD_VIDEO_CAPTURE_DESCRIPTOR_TOTAL_BULK(_stridx, _epin, _epsize) \
+  TUD_VIDEO_CAPTURE_DESCRIPTOR_TOTAL_FORMATS(_stridx, _epin, 1), \
         TUD_VIDEO_DESC_EP_BULK(_epin, _epsize, 1)
 
+/* One isochronous alternate setting per UVC_ISO_PACKET_SIZES() entry, comma included. */
+#define TUD_VIDEO_DESC_VS_ALT_ISO(_alt, _epsize, _stridx, _epin) \
+  TUD_VIDEO_DESC_STD_VS(ITF_NUM_VIDEO_STREAMING, _alt, 1, _stridx), \
+    TUD_VIDEO_DESC_EP_ISO(_epin, _epsize, 1),
+
+#define TUD_VIDEO_CAPTURE_DESCRIPTOR_TOTAL_ISO(_stridx, _epin) \
+  TUD_VIDEO_CAPTURE_DESCRIPTOR_TOTAL_FORMATS(_stridx, _epin, 0), \
+  /* VS alt 1..UVC_ISO_ALT_COUNT */ \
+  UVC_ISO_PACKET_SIZES(TUD_VIDEO_DESC_VS_ALT_ISO, _stridx, _epin)
+
 #endif
@@ -0,0 +1,46 @@
+#ifndef VIDEO_PACING_H
+#define VIDEO_PACING_H
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+// Frame pacing of the FreeRTOS video task: one frame slot per committed frame
+// interval, on a grid of ticks started by video_pacing_reset().
+struct video_pacing {
+    TickType_t deadline; // start of the current frame slot
+    uint32_t tick_frac;  // fraction of a tick the slots so far fell short, in us/configTICK_RATE_HZ
+    uint32_t overruns;   // slots started late because the last frame took too long
+    uint32_t skipped;    // whole slots missed by those overruns
+    uint32_t dropped;    // frames captured on time but not sent, the last one still in flight
+};
+
+// Start the grid over from now, when streaming starts or the mode changes: the
+// next slot is a whole frame interval away, slots of the old mode are not caught up.
+static inline void video_pacing_reset(struct video_pacing *pacing) {
+    pacing->deadline = xTaskGetTickCount();
+    pacing->tick_frac = 0;
+}
+
+// Sleep until the next frame slot of interval_us. A frame that overran its slot
+// starts the next one at once, slots missed entirely are skipped instead of being
+// caught up with a burst of frames. An interval that is not a whole number of
+// ticks carries the remainder into the next slot, so the frame rate does not drift.
+static inline void video_pacing_wait(struct video_pacing *pacing, uint32_t interval_us) {
+    uint64_t ticks = (uint64_t)interval_us * configTICK_RATE_HZ + pacing->tick_frac;
+    TickType_t period = (TickType_t)(ticks / 1000000);
+    pacing->tick_frac = (uint32_t)(ticks % 1000000);
+    if (period == 0) {
+        period = 1;
+        pacing->tick_frac = 0;
+    }
+    if (xTaskDelayUntil(&pacing->deadline, period))
+        return;
+
+    TickType_t late = xTaskGetTickCount() - pacing->deadline;
+    pacing->overruns++;
+    pacing->skipped += late / period;
+    pacing->deadline += late / period * period;
+}
+
+#endif
@@ -0,0 +1,300 @@
+/**
+ * RGB565 <-> YUY2 conversion for the UVC stream and the LCD preview, and the
+ * YUY2 -> Y8 and 4:2:0 planar conversions for the grey, NV12 and I420 streams.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "yuv.h"
+
+// Unpack pixels with the SIO interpolators instead of shift/mask/add on the CPU.
+// Both paths give bit-identical output.
+#ifndef YUV_USE_INTERP
+#define YUV_USE_INTERP 1
+#endif
+
+#if YUV_USE_INTERP
+#include "hardware/interp.h"
+#endif
+
+// Contribution of one RGB565 component to VP8RGBToY/U/V, indexed by the raw
+// 5 or 6 bit value after the same expansion as color16to24(). The conversion is
+// linear, so summing the entries gives bit-identical results to the fixed-point
+// code. Y folds its rounding into the green table; U and V add half of their
+// rounding and bias through the blue entry of each of the two pixels. VP8RGBToU/V
+// take the sum of a 2x2 block, the pair's sum counts twice: one bit less shift.
+// Entries are 16 bytes so the interpolators can turn a component straight into
+// an entry address.
+struct yuv_contrib {
+    int32_t y, u, v, pad;
+};
+
+static struct yuv_contrib lut_r[32], lut_g[64], lut_b[32];
+static bool lut_ready;
+
+static void yuv_lut_init(void) {
+    const int32_t uv_bias = ((YUV_HALF << 1) + (128 << (YUV_FIX + 1))) / 2;
+    uint8_t rgb[3];
+
+    for (int i = 0; i < 32; i++) {
+        color16to24((uint16_t)(i << 11 | i), rgb);
+        lut_r[i].y = kRToY * rgb[0];
+        lut_r[i].u = kRToU * rgb[0];
+        lut_r[i].v = kRToV * rgb[0];
+        lut_b[i].y = kBToY * rgb[2];
+        lut_b[i].u = kBToU * rgb[2] + uv_bias;
+        lut_b[i].v = kBToV * rgb[2] + uv_bias;
+    }
+    for (int i = 0; i < 64; i++) {
+        color16to24((uint16_t)(i << 5), rgb);
+        lut_g[i].y = kGToY * rgb[1] + YUV_HALF + kYOffset;
+        lut_g[i].u = kGToU * rgb[1];
+        lut_g[i].v = kGToV * rgb[1];
+    }
+    lut_ready = true;
+}
+
+static inline int clip_uv(int uv) {
+    return ((uv & ~0xff) == 0) ? uv : (uv < 0) ? 0 : 255;
+}
+
+static inline uint32_t yuv_pack(const struct yuv_contrib *r1, const struct yuv_contrib *g1,
+                                const struct yuv_contrib *b1, const struct yuv_contrib *r2,
+                                const struct yuv_contrib *g2, const struct yuv_contrib *b2) {
+    int y1 = (r1->y + g1->y + b1->y) >> YUV_FIX;
+    int y2 = (r2->y + g2->y + b2->y) >> YUV_FIX;
+    int u = (r1->u + r2->u + g1->u + g2->u + b1->u + b2->u) >> (YUV_FIX + 1);
+    int v = (r1->v + r2->v + g1->v + g2->v + b1->v + b2->v) >> (YUV_FIX + 1);
+
+    return (uint32_t)y1 | (uint32_t)clip_uv(u) << 8 | (uint32_t)y2 << 16 |
+           (uint32_t)clip_uv(v) << 24;
+}
+
+#if YUV_USE_INTERP
+// interp0 turns the red and green of the first pixel into table addresses,
+// interp1 those of the second pixel. Blue is left to the CPU: it sits in the
+// low bits and the interpolators can only shift right.
+static void rgb565_interp_setup(void) {
+    interp_config cfg = interp_default_config();
+
+    interp_config_set_shift(&cfg, 7);
+    interp_config_set_mask(&cfg, 4, 8);
+    interp_set_config(interp0, 0, &cfg);
+    interp_config_set_shift(&cfg, 23);
+    interp_set_config(interp1, 0, &cfg);
+
+    interp_config_set_cross_input(&cfg, true);
+    interp_config_set_shift(&cfg, 1);
+    interp_config_set_mask(&cfg, 4, 9);
+    interp_set_config(interp0, 1, &cfg);
+    interp_config_set_shift(&cfg, 17);
+    interp_set_config(interp1, 1, &cfg);
+
+    interp0->base[0] = (uintptr_t)lut_r;
+    interp0->base[1] = (uintptr_t)lut_g;
+    interp1->base[0] = (uintptr_t)lut_r;
+    interp1->base[1] = (uintptr_t)lut_g;
+}
+#endif
+
+// In place, two pixels per word: Y0 U Y1 V.
+void rgb565_to_yuv422(uint32_t *data, int len) {
+    if (!lut_ready)
+        yuv_lut_init();
+
+#if YUV_USE_INTERP
+    rgb565_interp_setup();
+    for (int i = 0; i < len; i++, data++) {
+        uint32_t px = *data;
+
+        interp0->accum[0] = px;
+        interp1->accum[0] = px;
+        *data = yuv_pack((const struct yuv_contrib *)interp0->peek[0],
+                         (const struct yuv_contrib *)interp0->peek[1], &lut_b[px & 0x1f],
+                         (const struct yuv_contrib *)interp1->peek[0],
+                         (const struct yuv_contrib *)interp1->peek[1], &lut_b[(px >> 16) & 0x1f]);
+    }
+#else
+    for (int i = 0; i < len; i++, data++) {
+        uint32_t px = *data;
+
+        *data = yuv_pack(&lut_r[(px >> 11) & 0x1f], &lut_g[(px >> 5) & 0x3f], &lut_b[px & 0x1f],
+                         &lut_r[(px >> 27) & 0x1f], &lut_g[(px >> 21) & 0x3f],
+                         &lut_b[(px >> 16) & 0x1f]);
+    }
+#endif
+}
+
+#if YUV_USE_INTERP
+// interp1 lane 0 in clamp mode does VP8Clip8: shift out the fraction,
+// sign-extend and clamp to 0..255.
+static void clip8_interp_setup(void) {
+    interp_config cfg = interp_default_config();
+
+    interp_config_set_shift(&cfg, YUV_FIX2);
+    interp_config_set_mask(&cfg, 0, 31 - YUV_FIX2);
+    interp_config_set_signed(&cfg, true);
+    interp_config_set_clamp(&cfg, true);
+    interp_set_config(interp1, 0, &cfg);
+    interp1->base[0] = 0;
+    interp1->base[1] = 255;
+}
+
+static inline int clip8(int v) {
+    interp1->accum[0] = (uint32_t)v;
+    return (int)interp1->peek[0];
+}
+#else
+#define clip8 VP8Clip8
+#endif
+
+static inline uint32_t rgb565_pack(int r, int g, int b) {
+    return (uint32_t)((r & 0xf8) << 8 | (g & 0xfc) << 3 | b >> 3);
+}
+
+// Chroma terms of VP8YUVToR/G/B, indexed by U or V. The green term is split
+// between the two tables, its constant rides on the U side.
+struct yuv_chroma {
+    int32_t g, rb;
+};
+
+static struct yuv_chroma lut_u[256], lut_v[256];
+static bool chroma_lut_ready;
+
+static void yuv_chroma_lut_init(void) {
+    for (int i = 0; i < 256; i++) {
+        lut_u[i].g = -kUToG * i + kGCst;
+        lut_u[i].rb = kUToB * i + kBCst;
+        lut_v[i].g = -kVToG * i;
+        lut_v[i].rb = kVToR * i + kRCst;
+    }
+    chroma_lut_ready = true;
+}
+
+// Y plane of YUYV words, four pixels per output word. dst may be src itself, it
+// never gets ahead of the words still to be read. len counts source words.
+void yuv422_to_y8(const uint32_t *src, uint8_t *dst, int len) {
+    uint32_t *out = (uint32_t *)dst;
+    int i;
+
+    for (i = 0; i + 1 < len; i += 2) {
+        uint32_t a = src[i], b = src[i + 1];
+
+        *out++ = (a & 0xff) | (a >> 8 & 0xff00) | (b & 0xff) << 16 | (b & 0xff0000) << 8;
+    }
+    if (i < len) {
+        dst = (uint8_t *)out;
+        dst[0] = (uint8_t)src[i];
+        dst[1] = (uint8_t)(src[i] >> 16);
+    }
+}
+
+// A 4:2:0 frame is built in units of half a line (width / 2 bytes). Row pair k is
+// packed to units 6k..6k+5 as Y row 2k, Y row 2k+1 and one line of chroma: the
+// U/V pairs for NV12, the U then the V half line for I420. The output never gets
+// ahead of the input, so it fits in the frame buffer, and yuv420_planarize() then
+// moves every unit to its place in the planes.
+
+// Averages the chroma of the two rows. The first row is copied to scratch first,
+// the second one is read in place: it lies past everything written here. I420
+// chroma is split into its U and V halves once the second row has been read.
+void yuv420_pack_rows(uint8_t *buf, int width, int pair, enum yuv420_layout layout, bool rgb565,
+                      uint8_t *scratch) {
+    const uint32_t *a = (const uint32_t *)scratch;
+    uint32_t *b = (uint32_t *)(buf + pair * width * 4 + width * 2);
+    uint8_t *ya = buf + pair * width * 3;
+    uint8_t *yb = ya + width;
+    uint8_t *c = yb + width;
+    int words = width / 2;
+
+    memcpy(scratch, buf + pair * width * 4, (size_t)width * 2);
+    if (rgb565) {
+        rgb565_to_yuv422((uint32_t *)scratch, words);
+        rgb565_to_yuv422(b, words);
+    }
+    for (int j = 0; j < words; j++) {
+        uint32_t pa = a[j], pb = b[j];
+        uint8_t u = (uint8_t)((((pa >> 8) & 0xff) + ((pb >> 8) & 0xff) + 1) >> 1);
+        uint8_t v = (uint8_t)(((pa >> 24) + (pb >> 24) + 1) >> 1);
+
+        ya[2 * j] = (uint8_t)pa;
+        ya[2 * j + 1] = (uint8_t)(pa >> 16);
+        yb[2 * j] = (uint8_t)pb;
+        yb[2 * j + 1] = (uint8_t)(pb >> 16);
+        c[2 * j] = u;
+        c[2 * j + 1] = v;
+    }
+    if (layout == YUV420_I420) {
+        memcpy(scratch, c, (size_t)width);
+        for (int j = 0; j < words; j++) {
+            c[j] = scratch[2 * j];
+            c[words + j] = scratch[2 * j + 1];
+        }
+    }
+}
+
+// Packed unit that belongs at unit d of the planar frame.
+static int yuv420_unit_src(int d, int height, enum yuv420_layout layout) {
+    if (d < 2 * height)
+        return d / 4 * 6 + d % 4;
+    d -= 2 * height;
+    if (layout == YUV420_NV12)
+        return d / 2 * 6 + 4 + d % 2;
+    if (d < height / 2)
+        return d * 6 + 4;
+    return (d - height / 2) * 6 + 5;
+}
+
+// Follows each cycle of the permutation once, with one unit of scratch and a
+// bitmap of the units already in place.
+void yuv420_planarize(uint8_t *buf, int width, int height, enum yuv420_layout layout, uint8_t *scratch) {
+    size_t unit = (size_t)width / 2;
+    int units = 3 * height;
+    uint32_t *done = (uint32_t *)(scratch + 2 * width);
+
+    memset(done, 0, (size_t)(units + 31) / 32 * 4);
+    for (int s = 0; s < units; s++) {
+        if (done[s / 32] & (1u << (s % 32)))
+            continue;
+        memcpy(scratch, buf + s * unit, unit);
+        for (int d = s;;) {
+            int p = yuv420_unit_src(d, height, layout);
+
+            done[d / 32] |= 1u << (d % 32);
+            if (p == s) {
+                memcpy(buf + d * unit, scratch, unit);
+                break;
+            }
+            memcpy(buf + d * unit, buf + p * unit, unit);
+            d = p;
+        }
+    }
+}
+
+// Two RGB565 pixels per word, first pixel in the low half, in the same byte
+// order as VP8YuvToRgb565(). The chroma terms are looked up once and shared by
+// both pixels, only the luma takes a multiply.
+void yuv422_to_rgb565_words(const uint32_t *src, uint32_t *dst, int len) {
+    if (!chroma_lut_ready)
+        yuv_chroma_lut_init();
+#if YUV_USE_INTERP
+    clip8_interp_setup();
+#endif
+    for (int i = 0; i < len; i++) {
+        uint32_t px = src[i];
+        int y1 = kYScale * (int)(px & 0xff);
+        int y2 = kYScale * (int)((px >> 16) & 0xff);
+        const struct yuv_chroma *u = &lut_u[(px >> 8) & 0xff];
+        const struct yuv_chroma *v = &lut_v[px >> 24];
+        int cr = v->rb;
+        int cg = u->g + v->g;
+        int cb = u->rb;
+
+        dst[i] = rgb565_pack(clip8(y1 + cr), clip8(y1 + cg), clip8(y1 + cb)) |
+                 rgb565_pack(clip8(y2 + cr), clip8(y2 + cg), clip8(y2 + cb)) << 16;
+    }
+}
@@ -35,6 +35,7 @@
 #ifndef RP2040_YUV_H_
 #define RP2040_YUV_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
 enum {
@@ -88,8 +89,6 @@ static inline void VP8YuvToRgb565(int y, int u, int v,
 #endif
 }
 
-uint16_t yuv422_to_rgb565(int y, int u, int v);
-
 //------------------------------------------------------------------------------
 // RGB -> YUV conversion
 // Stub functions that can be called with various rounding values:
@@ -100,35 +99,45 @@ static inline int VP8ClipUV(int uv, int rounding) {
 }
 
 #define USE_YUVj
+// RGB -> YUV coefficients, shared with the lookup tables in yuv.c.
 #ifndef USE_YUVj
+#define kRToY 16839
+#define kGToY 33059
+#define kBToY 6420
+#define kYOffset (16 << YUV_FIX)
+#define kRToU (-9719)
+#define kGToU (-19081)
+#define kBToU 28800
+#define kRToV 28800
+#define kGToV (-24116)
+#define kBToV (-4684)
+#else
+#define kRToY 19595
+#define kGToY 38470
+#define kBToY 7471
+#define kYOffset 0
+#define kRToU (-11058)
+#define kGToU (-21710)
+#define kBToU 32768
+#define kRToV 32768
+#define kGToV (-27439)
+#define kBToV (-5329)
+#endif // USE_YUVj
+
 static inline int VP8RGBToY(int r, int g, int b, int rounding) {
-    const int luma = 16839 * r + 33059 * g + 6420 * b;
-    return (luma + rounding + (16 << YUV_FIX)) >> YUV_FIX; // no need to clip
+    const int luma = kRToY * r + kGToY * g + kBToY * b;
+    return (luma + rounding + kYOffset) >> YUV_FIX; // no need to clip
 }
 
 static inline int VP8RGBToU(int r, int g, int b, int rounding) {
-    const int u = -9719 * r - 19081 * g + 28800 * b;
+    const int u = kRToU * r + kGToU * g + kBToU * b;
     return VP8ClipUV(u, rounding);
 }
 
 static inline int VP8RGBToV(int r, int g, int b, int rounding) {
-    const int v = +28800 * r - 24116 * g - 4684 * b;
+    const int v = kRToV * r + kGToV * g + kBToV * b;
     return VP8ClipUV(v, rounding);
 }
-#else
-static inline int VP8RGBToY(int r, int g, int b, int rounding) {
-    const int luma = 19595 * r + 38470 * g + 7471 * b;
-    return (luma + rounding) >> YUV_FIX; // no need to clip
-}
-static inline int VP8RGBToU(int r, int g, int b, int rounding) {
-    const int u = -11058 * r - 21710 * g + 32768 * b;
-    return VP8ClipUV(u, rounding);
-}
-static inline int VP8RGBToV(int r, int g, int b, int rounding) {
-    const int v = 32768 * r - 27439 * g - 5329 * b;
-    return VP8ClipUV(v, rounding);
-}
-#endif // USE_YUVj
 
 static inline void color16to24(uint16_t color565,uint8_t *dst) {
     dst[0] = (color565 >> 8) & 0xF8;
@@ -140,5 +149,20 @@ static inline void color16to24(uint16_t color565,uint8_t *dst) {
 }
 
 void rgb565_to_yuv422(uint32_t * data, int len);
+void yuv422_to_rgb565_words(const uint32_t *src, uint32_t *dst, int len);
+void yuv422_to_y8(const uint32_t *src, uint8_t *dst, int len);
+
+// Planar 4:2:0, built in place from a YUYV or RGB565 frame: yuv420_pack_rows() for
+// every row pair, top to bottom, then yuv420_planarize(). width must be a multiple
+// of 4, height even. scratch is word aligned, YUV420_SCRATCH_SIZE() bytes.
+enum yuv420_layout {
+    YUV420_NV12, // Y plane, then interleaved U/V rows
+    YUV420_I420, // Y plane, U plane, V plane
+};
+#define YUV420_SCRATCH_SIZE(width, height) (2 * (width) + ((3 * (height) + 31) / 32) * 4)
+
+void yuv420_pack_rows(uint8_t *buf, int width, int pair, enum yuv420_layout layout, bool rgb565,
+                      uint8_t *scratch);
+void yuv420_planarize(uint8_t *buf, int width, int height, enum yuv420_layout layout, uint8_t *scratch);
 
 #endif // RP2040_YUV_H_
\ No newline at end of file